@@ -0,0 +1,89 @@
+#include "bench.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+// ----- ALLOCATION COUNTING ----- //
+static std::atomic<std::uint64_t> g_allocs{0};
+static std::atomic<std::uint64_t> g_bytes{0};
+
+static void *countedAlloc(const std::size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new(const std::size_t size) {
+    if (void *p = countedAlloc(size)) return p;
+    throw std::bad_alloc{};
+}
+
+void *operator new[](const std::size_t size) {
+    if (void *p = countedAlloc(size)) return p;
+    throw std::bad_alloc{};
+}
+
+void *operator new(const std::size_t size, const std::nothrow_t &) noexcept {
+    return countedAlloc(size);
+}
+
+void *operator new[](const std::size_t size, const std::nothrow_t &) noexcept {
+    return countedAlloc(size);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+std::uint64_t allocationCount() {
+    return g_allocs.load(std::memory_order_relaxed);
+}
+
+std::uint64_t allocatedBytes() {
+    return g_bytes.load(std::memory_order_relaxed);
+}
+
+// ----- RESULTS ----- //
+static std::string g_group;
+
+void setBenchGroup(const std::string &group) {
+    g_group = group;
+}
+
+const std::string &benchGroup() {
+    return g_group;
+}
+
+std::vector<BenchResult> &benchResults() {
+    static std::vector<BenchResult> results;
+    return results;
+}
+
+picojson::value benchResultsJson() {
+    picojson::object context;
+#ifdef __VERSION__
+    context["compiler"] = picojson::value(__VERSION__);
+#endif
+    context["hardware_threads"] = picojson::value(static_cast<double>(std::thread::hardware_concurrency()));
+
+    picojson::array benchmarks;
+    for (const auto &r: benchResults()) {
+        picojson::object obj;
+        obj["group"] = picojson::value(r.group);
+        obj["name"] = picojson::value(r.name);
+        obj["iterations"] = picojson::value(static_cast<double>(r.iters));
+        obj["ns_per_op"] = picojson::value(r.nsPerOp);
+        obj["ops_per_sec"] = picojson::value(1e9 / r.nsPerOp);
+        obj["allocs_per_op"] = picojson::value(r.allocsPerOp);
+        obj["bytes_per_op"] = picojson::value(r.bytesPerOp);
+        benchmarks.emplace_back(obj);
+    }
+
+    picojson::object root;
+    root["context"] = picojson::value(context);
+    root["benchmarks"] = picojson::value(benchmarks);
+    return picojson::value(root);
+}
@@ -0,0 +1,84 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#include "../include/expr-eval/picojson.h"
+
+// Keep the optimizer from discarding a computed value
+template<typename T>
+void doNotOptimize(const T &value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    // No inline asm on MSVC: leak the address through a volatile store
+    // and keep memory accesses from moving across the call
+    static thread_local const void *volatile sink;
+    sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+// ----- ALLOCATION COUNTING ----- //
+// Totals since startup, over all threads; the global operator new is
+// replaced in bench.cpp to maintain them.
+std::uint64_t allocationCount();
+
+std::uint64_t allocatedBytes();
+
+// ----- RESULTS ----- //
+struct BenchResult {
+    std::string group;
+    std::string name;
+    std::size_t iters;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+// Group that following runBench() results are filed under
+void setBenchGroup(const std::string &group);
+
+const std::string &benchGroup();
+
+std::vector<BenchResult> &benchResults();
+
+// All results so far, as {"context": ..., "benchmarks": [...]}
+picojson::value benchResultsJson();
+
+// Time `iters` calls of `fn` and print the cost per call.
+// Returns the measured nanoseconds per operation.
+template<typename Fn>
+double runBench(const std::string &name, const std::size_t iters, Fn &&fn) {
+    const auto allocs = allocationCount();
+    const auto bytes = allocatedBytes();
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iters; ++i) {
+        fn();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    const auto n = static_cast<double>(iters);
+    const auto ns = std::chrono::duration<double, std::nano>(end - start).count();
+    const BenchResult res{
+        benchGroup(), name, iters, ns / n,
+        static_cast<double>(allocationCount() - allocs) / n,
+        static_cast<double>(allocatedBytes() - bytes) / n
+    };
+    benchResults().push_back(res);
+
+    std::printf("%-40s %12.1f ns/op %14.0f ops/sec %10.2f allocs/op\n",
+                name.c_str(), res.nsPerOp, 1e9 / res.nsPerOp, res.allocsPerOp);
+    return res.nsPerOp;
+}
+
+#endif // BENCH_H
@@ -0,0 +1,1091 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "../include/expr-eval/backend/interpreter.h"
+#include "../include/expr-eval/backend/batch.h"
+#include "../include/expr-eval/backend/eval_counters.h"
+#include "../include/expr-eval/backend/expr_dag.h"
+#include "../include/expr-eval/backend/expr_pack.h"
+#include "../include/expr-eval/backend/formula_graph.h"
+#include "../include/expr-eval/backend/profiler.h"
+#include "../include/expr-eval/backend/mapped_file.h"
+#include "../include/expr-eval/backend/stream_runner.h"
+#include "../include/expr-eval/backend/thread_pool.h"
+#include "../include/expr-eval/backend/trace.h"
+
+static void benchCompileOnce() {
+    const std::string src = "x * 2 + PI * (x - 3) % 7 >= 10 && f_name == \"John\"";
+    constexpr std::size_t iters = 200000;
+
+    Interpreter ip;
+    ip.addVar("f_name", RuntimeVar(std::string{"John"}));
+    ip.addVar("x", RuntimeVar(23.45));
+    ip.addVar("PI", RuntimeVar(3.14));
+
+    std::printf("== compile once / evaluate many ==\n");
+    ip.setCacheCapacity(0);
+    const auto reparse = runBench("eval(source), uncached", iters, [&] {
+        doNotOptimize(ip.eval(src));
+    });
+
+    ip.setCacheCapacity(ExprCache::kDefaultCapacity);
+    const auto cached = runBench("eval(source), cached", iters, [&] {
+        doNotOptimize(ip.eval(src));
+    });
+
+    const auto expr = ip.compile(src);
+    const auto compiled = runBench("eval(compiled)", iters, [&] {
+        doNotOptimize(ip.eval(expr));
+    });
+
+    const auto &stats = ip.cache().stats();
+    std::printf("speedup: cached %.2fx, compiled %.2fx (cache hits %llu, misses %llu)\n\n",
+                reparse / cached, reparse / compiled,
+                static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses));
+}
+
+static void benchExprCache() {
+    constexpr std::size_t distinct = 256;
+    constexpr std::size_t iters = 200000;
+
+    Interpreter ip;
+    ip.addVar("x", RuntimeVar(2.0));
+
+    std::vector<std::string> sources;
+    for (std::size_t i = 0; i < distinct; ++i)
+        sources.push_back(std::format("x * {} + (x - {}) / 3 > {}", i, i % 7, i % 13));
+
+    std::printf("== expression cache, %zu distinct sources ==\n", distinct);
+    for (const std::size_t capacity: {std::size_t{0}, distinct / 4, distinct}) {
+        ip.setCacheCapacity(capacity);
+        ip.clearCache();
+
+        const auto before = ip.cache().stats();
+        std::size_t i = 0;
+        runBench(std::format("capacity {}", capacity), iters, [&] {
+            // Hot set of 16 sources with an occasional cold one
+            const auto &src = i % 8 == 0 ? sources[i / 8 % distinct] : sources[i % 16];
+            doNotOptimize(ip.eval(src));
+            ++i;
+        });
+
+        const auto &after = ip.cache().stats();
+        std::printf("hits %llu, misses %llu, evictions %llu\n",
+                    static_cast<unsigned long long>(after.hits - before.hits),
+                    static_cast<unsigned long long>(after.misses - before.misses),
+                    static_cast<unsigned long long>(after.evictions - before.evictions));
+    }
+    std::printf("\n");
+}
+
+static void benchSlotUpdates() {
+    constexpr std::size_t iters = 200000;
+
+    Interpreter ip;
+    ip.addVar("x", RuntimeVar(0.0));
+    ip.addVar("y", RuntimeVar(1.0));
+    const auto expr = ip.compile("x * y + x - y");
+    const auto x = ip.slotOf("x");
+
+    std::printf("== variable updates: by name vs by slot ==\n");
+    double v = 0.0;
+    const auto byName = runBench("addVar(name) + eval", iters, [&] {
+        ip.addVar("x", RuntimeVar(v += 1.0));
+        doNotOptimize(ip.eval(expr));
+    });
+    const auto bySlot = runBench("setVar(slot) + eval", iters, [&] {
+        ip.setVar(x, RuntimeVar(v += 1.0));
+        doNotOptimize(ip.eval(expr));
+    });
+
+    std::printf("speedup: %.2fx\n\n", byName / bySlot);
+}
+
+// Left-deep arithmetic chain with nested parens, `terms` operands long
+static std::string deepArithmetic(const int terms) {
+    std::string src = "x";
+    for (int i = 1; i < terms; ++i) {
+        src = std::format("({} {} {})", src, "+-*"[i % 3], i % 7 + 1);
+    }
+    return src;
+}
+
+static void benchEngines() {
+    const std::string src = deepArithmetic(200);
+    constexpr std::size_t iters = 20000;
+
+    std::printf("== tree walker vs bytecode VM (deep arithmetic) ==\n");
+
+    Interpreter ip;
+    ip.addVar("x", RuntimeVar(1.5));
+
+    ip.setEngine(Engine::TREE_WALKER);
+    const auto tree = ip.compile(src);
+    ip.setEngine(Engine::BYTECODE);
+    const auto bytecode = ip.compile(src);
+
+    if (ip.eval(tree).toString() != ip.eval(bytecode).toString()) {
+        std::printf("engine mismatch for %s\n", src.c_str());
+        return;
+    }
+
+    const auto treeNs = runBench("tree walker", iters, [&] {
+        doNotOptimize(ip.eval(tree));
+    });
+    const auto vmNs = runBench("bytecode vm", iters, [&] {
+        doNotOptimize(ip.eval(bytecode));
+    });
+
+    std::printf("speedup: %.2fx\n\n", treeNs / vmNs);
+}
+
+// Same bits, not just the same printed value; NaN results must match too
+static bool sameBits(const RuntimeVar &a, const RuntimeVar &b) {
+    if (a.type != b.type) return false;
+    if (a.type == RuntimeVar::RuntimeVarType::NUMBER)
+        return std::bit_cast<std::uint64_t>(a.d_value) == std::bit_cast<std::uint64_t>(b.d_value);
+    return a.toString() == b.toString();
+}
+
+static void benchJit() {
+    const std::vector<std::pair<std::string, std::string> > sources{
+        {"deep arithmetic (200 terms)", deepArithmetic(200)},
+        {"polynomial", "(x * x + y * y) / (x - y + 3) - x / 2 * y"},
+        {"predicate", "x * 3 + y * y - 7 > y / 2 && y != 0 || x == y"},
+        {"right-deep", "y / (x + y / (x + y / (x + y / (x + y / (x + y)))))"},
+    };
+    const double values[]{0.0, -0.0, 1.5, -2.25, 1e308, 5e-324, INFINITY, -INFINITY, NAN};
+    constexpr std::size_t iters = 200000;
+
+    std::printf("== native JIT vs tree walker ==\n");
+    if (!JitCompiler::kSupported) {
+        std::printf("JIT not supported on this platform\n\n");
+        return;
+    }
+
+    Interpreter ip;
+    ip.addVar("x", RuntimeVar(0.0));
+    ip.addVar("y", RuntimeVar(0.0));
+    const auto x = ip.slotOf("x"), y = ip.slotOf("y");
+
+    for (const auto &[name, src]: sources) {
+        ip.setEngine(Engine::TREE_WALKER);
+        const auto tree = ip.compile(src);
+        ip.setEngine(Engine::JIT);
+        const auto jit = ip.compile(src);
+
+        if (!jit.jit()) {
+            std::printf("%s: not compiled\n", name.c_str());
+            continue;
+        }
+
+        std::size_t mismatches = 0;
+        for (const double a: values) {
+            for (const double b: values) {
+                ip.setVar(x, RuntimeVar(a));
+                ip.setVar(y, RuntimeVar(b));
+                if (!sameBits(ip.eval(tree), ip.eval(jit))) ++mismatches;
+            }
+        }
+
+        std::printf("%s: %zu bytes of code, %zu/%zu inputs bit-identical\n", name.c_str(),
+                    jit.jit()->codeSize(), std::size(values) * std::size(values) - mismatches,
+                    std::size(values) * std::size(values));
+
+        ip.setVar(x, RuntimeVar(1.5));
+        ip.setVar(y, RuntimeVar(2.5));
+        const auto treeNs = runBench("  tree walker", iters / 10, [&] {
+            doNotOptimize(ip.eval(tree));
+        });
+        const auto jitNs = runBench("  jit", iters, [&] {
+            doNotOptimize(ip.eval(jit));
+        });
+        std::printf("  speedup: %.2fx\n", treeNs / jitNs);
+    }
+    std::printf("\n");
+}
+
+static void benchShortCircuit() {
+    // A cheap guard in front of an expensive rule body, as in rule predicates
+    const std::string body = deepArithmetic(100) + " > 1000";
+    const std::string guarded = "x > 100 && " + body;
+    const std::string conditional = "x > 100 ? " + body + " : x < 0";
+    constexpr std::size_t iters = 100000;
+
+    std::printf("== short-circuit && and lazy ?: (guard false) ==\n");
+
+    Interpreter ip;
+    ip.addVar("x", RuntimeVar(1.5));
+
+    for (const auto engine: {Engine::TREE_WALKER, Engine::BYTECODE}) {
+        ip.setEngine(engine);
+        const auto full = ip.compile(body);
+        const auto andExpr = ip.compile(guarded);
+        const auto condExpr = ip.compile(conditional);
+        const char *name = engine == Engine::TREE_WALKER ? "tree" : "vm";
+
+        const auto fullNs = runBench(std::format("{}: body alone", name), iters / 10, [&] {
+            doNotOptimize(ip.eval(full));
+        });
+
+        evalCounters() = {};
+        const auto andNs = runBench(std::format("{}: guard && body", name), iters, [&] {
+            doNotOptimize(ip.eval(andExpr));
+        });
+        const auto andCounters = evalCounters();
+
+        const auto condNs = runBench(std::format("{}: guard ? body : x < 0", name), iters, [&] {
+            doNotOptimize(ip.eval(condExpr));
+        });
+
+        std::printf("skipped %llu of %llu lazy operands; body costs %.1fx the guarded &&, %.1fx the ?:\n",
+                    static_cast<unsigned long long>(andCounters.skipped),
+                    static_cast<unsigned long long>(andCounters.branches),
+                    fullNs / andNs, fullNs / condNs);
+    }
+    std::printf("\n");
+}
+
+static void benchStringConcat() {
+    // Templated message: name, separator, name, ...
+    const std::string first = "Jonathan", last = "Richardson-Doe", sep = ", then ";
+    constexpr std::size_t iters = 50;
+
+    Interpreter ip;
+    ip.addVar("f_name", RuntimeVar(first));
+    ip.addVar("l_name", RuntimeVar(last));
+
+    const auto term = [&](const int i) -> const std::string & {
+        return i % 2 ? sep : (i % 4 == 2 ? last : first);
+    };
+
+    for (const int terms: {1000, 4000}) {
+        std::string src = "f_name";
+        for (int i = 1; i < terms; ++i)
+            src += i % 2 ? std::format(" + \"{}\"", sep) : (i % 4 == 2 ? " + l_name" : " + f_name");
+        const auto expr = ip.compile(src);
+
+        std::printf("== string concatenation, %d-term chain ==\n", terms);
+
+        // The previous string `+`: a fresh std::string per level, O(n^2)
+        // bytes copied. Measured without any interpreter overhead.
+        std::string expected;
+        const auto eagerNs = runBench("eager copy per + (C++ only)", iters, [&] {
+            std::string acc = first;
+            for (int i = 1; i < terms; ++i) {
+                std::string next;
+                next.reserve(acc.size() + term(i).size());
+                next.append(acc).append(term(i));
+                acc = std::move(next);
+            }
+            expected = std::move(acc);
+        });
+
+        bool match = true;
+        const auto evalNs = runBench("interpreter: eval + read text", iters, [&] {
+            const auto res = ip.eval(expr);
+            match &= res.str() == expected;
+        });
+
+        // Per-term cost stays flat for in-place appends and ropes, and
+        // grows linearly for copies
+        std::printf("result %zu bytes, text %s; ns/term: eager %.0f, interpreter %.0f; speedup %.2fx\n\n",
+                    expected.size(), match ? "matches" : "DIFFERS",
+                    eagerNs / terms, evalNs / terms, eagerNs / evalNs);
+    }
+}
+
+static void benchOptimizer() {
+    // Shape of machine-generated rule expressions: constant sub-terms and
+    // identity operands around a few variable references
+    const std::string src = "x * (60 * 60 * 24) + (100 - 3 * 4) * 1 + 0 > PI * 2 * (3 + 4)"
+                            " && true && (x / 1 - 0 >= (2 + 3) * (4 - 1) || false)";
+    constexpr std::size_t iters = 200000;
+
+    Interpreter ip;
+    ip.addVar("x", RuntimeVar(23.45));
+    ip.addVar("PI", RuntimeVar(3.14));
+
+    const auto plain = ip.compile(src, OptimizerOptions{.foldConstants = false, .simplify = false});
+    const auto optimized = ip.compile(src, OptimizerOptions{.foldConstants = true, .simplify = true});
+
+    std::printf("== constant folding + simplification ==\n");
+    std::printf("nodes: %zu -> %zu (%zu removed)\n", optimized.optimizerStats().nodesBefore,
+                optimized.optimizerStats().nodesAfter, optimized.optimizerStats().nodesRemoved());
+
+    const auto plainNs = runBench("unoptimized", iters, [&] {
+        doNotOptimize(ip.eval(plain));
+    });
+    const auto optNs = runBench("optimized", iters, [&] {
+        doNotOptimize(ip.eval(optimized));
+    });
+
+    std::printf("speedup: %.2fx\n\n", plainNs / optNs);
+}
+
+static void benchArena() {
+    const std::string src = "x * (60 * 60 * 24) + (100 - 3 * 4) * y > PI * 2 * (3 + 4) && f_name == \"John\"";
+    constexpr std::size_t iters = 100000;
+
+    SymbolTable symbols;
+    for (const auto *name: {"x", "y", "PI", "f_name"})
+        symbols.declare(name);
+
+    Parser parser;
+
+    std::printf("== AST arena ==\n");
+    runBench("Parser::parse (arena reused)", iters, [&] {
+        parser.parse(src, symbols);
+        doNotOptimize(parser.root().getNodes().size());
+    });
+    runBench("Parser::compile (fresh arena)", iters, [&] {
+        doNotOptimize(parser.compile(src, symbols));
+    });
+
+    const auto &arena = parser.root().arena();
+    std::printf("nodes per parse: %zu, arena bytes: %zu, blocks allocated over %zu parses: %zu\n\n",
+                arena.allocations(), arena.bytesUsed(), iters, arena.blockAllocations());
+}
+
+static void benchLexer() {
+    // ~1 MiB of mixed tokens
+    std::string src;
+    while (src.size() < (1u << 20))
+        src += "price * 1024 + (tax_rate * 100) >= limit && name != \"unknown\" || flag == true ";
+
+    constexpr std::size_t iters = 50;
+    Lexer lexer;
+
+    std::printf("== lexer over %zu KiB ==\n", src.size() / 1024);
+    const auto ns = runBench("Lexer::tokenize", iters, [&] {
+        doNotOptimize(lexer.tokenize(src).size());
+    });
+    std::printf("tokens: %zu, throughput: %.1f MiB/s\n\n", lexer.tokens().size(),
+                static_cast<double>(src.size()) / (1 << 20) / (ns / 1e9));
+}
+
+static void benchBatch() {
+    const std::string src = "x * 3 + y * y - 7 > z / 2 && z != 0";
+    constexpr std::size_t rows = 1 << 20;
+
+    Interpreter ip;
+    ip.addVar("x", RuntimeVar(0.0));
+    ip.addVar("y", RuntimeVar(0.0));
+    ip.addVar("z", RuntimeVar(0.0));
+    const auto expr = ip.compile(src);
+
+    std::vector<double> xs(rows), ys(rows), zs(rows), scalarOut(rows), batchOut(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        xs[i] = static_cast<double>(i % 1000) * 0.5;
+        ys[i] = static_cast<double>(i % 37);
+        zs[i] = static_cast<double>(i % 101);
+    }
+
+    std::printf("== batch (columnar) vs scalar over %zu rows ==\n", rows);
+
+    const auto x = ip.slotOf("x"), y = ip.slotOf("y"), z = ip.slotOf("z");
+    const auto scalarNs = runBench("scalar eval per row", 1, [&] {
+        for (std::size_t i = 0; i < rows; ++i) {
+            ip.setVar(x, RuntimeVar(xs[i]));
+            ip.setVar(y, RuntimeVar(ys[i]));
+            ip.setVar(z, RuntimeVar(zs[i]));
+            scalarOut[i] = ip.eval(expr).toBool() ? 1.0 : 0.0;
+        }
+    }) / rows;
+
+    const BatchProgram batch{expr.program()};
+    const std::vector<std::span<const double> > columns{xs, ys, zs};
+    const auto batchNs = runBench("BatchProgram::eval", 10, [&] {
+        batch.eval(columns, ip.values(), batchOut);
+    }) / rows;
+
+    std::printf("rows/sec: scalar %.0f, batch %.0f, speedup %.1fx, results %s\n\n",
+                1e9 / scalarNs, 1e9 / batchNs, scalarNs / batchNs,
+                scalarOut == batchOut ? "match" : "DIFFER");
+}
+
+static void benchParallelBatch() {
+    const std::string src = "x * 3 + y * y - 7 > z / 2 && z != 0";
+    constexpr std::size_t rows = 1 << 22;
+
+    Interpreter ip;
+    ip.addVar("x", RuntimeVar(0.0));
+    ip.addVar("y", RuntimeVar(0.0));
+    ip.addVar("z", RuntimeVar(0.0));
+    const BatchProgram batch{ip.compile(src).program()};
+
+    std::vector<double> xs(rows), ys(rows), zs(rows), serialOut(rows), parallelOut(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        xs[i] = static_cast<double>(i % 1000) * 0.5;
+        ys[i] = static_cast<double>(i % 37);
+        zs[i] = static_cast<double>(i % 101);
+    }
+    const std::vector<std::span<const double> > columns{xs, ys, zs};
+
+    std::printf("== parallel batch over %zu rows ==\n", rows);
+    const auto serialNs = runBench("BatchProgram::eval", 5, [&] {
+        batch.eval(columns, ip.values(), serialOut);
+    });
+
+    const std::size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool pool{threads};
+        const auto ns = runBench(std::format("evalParallel, {} threads", threads), 5, [&] {
+            batch.evalParallel(columns, ip.values(), parallelOut, pool);
+        });
+
+        std::printf("rows/sec %.0f, speedup vs serial %.2fx, results %s\n",
+                    rows * 1e9 / ns, serialNs / ns,
+                    serialOut == parallelOut ? "match" : "DIFFER");
+    }
+    std::printf("\n");
+}
+
+// ----- CORPUS ----- //
+// Realistic expression shapes for the per-stage and end-to-end benchmarks
+struct CorpusEntry {
+    std::string kind; // shape and index, e.g. "deep #2"
+    std::string src;
+};
+
+static std::vector<CorpusEntry> corpus() {
+    std::string variables = "v0";
+    for (int i = 1; i < 48; ++i)
+        variables += std::format(" {} v{}", "+-*"[i % 3], i);
+
+    std::string message = "f_name";
+    for (int i = 0; i < 20; ++i)
+        message += i % 2 ? " + \" \" + l_name" : " + \", \" + f_name";
+
+    return {
+        {"shallow #1", "price * qty > 100"},
+        {"shallow #2", "x + 1"},
+        {"deep #1", deepArithmetic(100)},
+        {"deep #2", "x > 10 ? (x > 20 ? (x > 30 ? 4 : 3) : 2) : (x < 0 ? 0 - 1 : (x < 5 ? 0 : 1))"},
+        {"string-heavy #1", message},
+        {"string-heavy #2", "f_name + \" \" + l_name == \"John Doe\" && l_name != \"Smith\" || f_name < l_name"},
+        {"variable-heavy #1", variables},
+        {"variable-heavy #2", "price * qty * (1 - discount) + shipping > budget && qty <= stock || vip == true"},
+    };
+}
+
+// Every variable referenced by corpus()
+static void declareCorpusVars(Interpreter &ip) {
+    ip.addVar("x", RuntimeVar(23.45));
+    ip.addVar("price", RuntimeVar(19.99));
+    ip.addVar("qty", RuntimeVar(7.0));
+    ip.addVar("discount", RuntimeVar(0.15));
+    ip.addVar("shipping", RuntimeVar(4.5));
+    ip.addVar("budget", RuntimeVar(150.0));
+    ip.addVar("stock", RuntimeVar(12.0));
+    ip.addVar("vip", RuntimeVar(false));
+    ip.addVar("f_name", RuntimeVar(std::string{"John"}));
+    ip.addVar("l_name", RuntimeVar(std::string{"Doe"}));
+    for (int i = 0; i < 48; ++i)
+        ip.addVar(std::format("v{}", i), RuntimeVar(1.0 + i % 5));
+}
+
+static void benchFrontend() {
+    constexpr std::size_t iters = 20000;
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+    Lexer lexer;
+    Parser parser;
+
+    std::printf("== lexer and parser per corpus entry ==\n");
+    for (const auto &[kind, src]: corpus()) {
+        runBench(std::format("Lexer::tokenize [{}]", kind), iters, [&] {
+            doNotOptimize(lexer.tokenize(src).size());
+        });
+        runBench(std::format("Parser::parse [{}]", kind), iters, [&] {
+            parser.parse(src, ip.symbols());
+            doNotOptimize(parser.root().getNodes().size());
+        });
+    }
+    std::printf("\n");
+}
+
+static void benchProgramEval() {
+    constexpr std::size_t iters = 20000;
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+    Parser parser;
+
+    std::printf("== Program::eval per corpus entry (tree walker, unoptimized) ==\n");
+    for (const auto &[kind, src]: corpus()) {
+        parser.parse(src, ip.symbols());
+        const auto &program = parser.root();
+        runBench(std::format("Program::eval [{}]", kind), iters, [&] {
+            doNotOptimize(program.eval(ip.values()));
+        });
+    }
+    std::printf("\n");
+}
+
+static void benchRuntimeOps() {
+    constexpr std::size_t iters = 1000000;
+
+    const RuntimeVar n1{23.45}, n2{7.0};
+    const RuntimeVar s1{std::string{"John"}}, s2{std::string{"Doe"}};
+    const RuntimeVar b1{true}, b2{false};
+
+    std::printf("== RuntimeVar operators ==\n");
+
+#define BENCH_OP(l, op, r, label) \
+    runBench(label, iters, [&] { doNotOptimize((l) op (r)); })
+
+    BENCH_OP(n1, +, n2, "number + number");
+    BENCH_OP(n1, -, n2, "number - number");
+    BENCH_OP(n1, *, n2, "number * number");
+    BENCH_OP(n1, /, n2, "number / number");
+    BENCH_OP(n1, %, n2, "number % number");
+    BENCH_OP(n1, ==, n2, "number == number");
+    BENCH_OP(n1, !=, n2, "number != number");
+    BENCH_OP(n1, <, n2, "number < number");
+    BENCH_OP(n1, <=, n2, "number <= number");
+    BENCH_OP(n1, >, n2, "number > number");
+    BENCH_OP(n1, >=, n2, "number >= number");
+    BENCH_OP(n1, &&, n2, "number && number");
+    BENCH_OP(n1, ||, n2, "number || number");
+    BENCH_OP(s1, +, s2, "string + string");
+    BENCH_OP(s1, ==, s2, "string == string");
+    BENCH_OP(s1, !=, s2, "string != string");
+    BENCH_OP(s1, <, s2, "string < string");
+    BENCH_OP(s1, <=, s2, "string <= string");
+    BENCH_OP(s1, >, s2, "string > string");
+    BENCH_OP(s1, >=, s2, "string >= string");
+    BENCH_OP(b1, &&, b2, "bool && bool");
+    BENCH_OP(b1, ||, b2, "bool || bool");
+    BENCH_OP(b1, ==, b2, "bool == bool");
+    BENCH_OP(b1, !=, b2, "bool != bool");
+
+#undef BENCH_OP
+
+    runBench("copy string", iters, [&] {
+        const RuntimeVar copy = s1;
+        doNotOptimize(copy);
+    });
+    std::printf("\n");
+}
+
+static void benchEndToEnd() {
+    constexpr std::size_t iters = 20000;
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+
+    std::printf("== Interpreter::eval(source) per corpus entry ==\n");
+    for (const auto &[kind, src]: corpus()) {
+        ip.setCacheCapacity(0);
+        runBench(std::format("eval, uncached [{}]", kind), iters, [&] {
+            doNotOptimize(ip.eval(src));
+        });
+
+        ip.setCacheCapacity(ExprCache::kDefaultCapacity);
+        runBench(std::format("eval, cached [{}]", kind), iters, [&] {
+            doNotOptimize(ip.eval(src));
+        });
+    }
+    std::printf("\n");
+}
+
+static void benchConcurrency() {
+    constexpr std::size_t iters = 100000; // evaluations per thread
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+    const auto qty = ip.slotOf("qty");
+    const auto src = "price * qty * (1 - discount) + shipping > budget && qty <= stock || qty > 14";
+
+    std::printf("== one shared CompiledExpr, one EvalContext per thread ==\n");
+
+    const std::size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (const auto engine: {Engine::TREE_WALKER, Engine::BYTECODE, Engine::JIT}) {
+        ip.setEngine(engine);
+        const auto expr = ip.compile(src);
+        const char *name = engine == Engine::TREE_WALKER ? "tree" : engine == Engine::BYTECODE ? "vm" : "jit";
+
+        // Every thread must count the same number of true results
+        auto worker = [&](std::size_t &trues) {
+            auto ctx = ip.makeContext();
+            trues = 0;
+            for (std::size_t i = 0; i < iters; ++i) {
+                ctx.set(qty, RuntimeVar(static_cast<double>(i % 16)));
+                trues += expr.eval(ctx).toBool();
+            }
+        };
+
+        std::size_t expected = 0;
+        worker(expected);
+
+        double singleRate = 0.0;
+        for (std::size_t threads = 1; threads <= maxThreads; threads *= 2) {
+            std::vector<std::size_t> trues(threads);
+            const auto ns = runBench(std::format("{}: {} threads", name, threads), 1, [&] {
+                std::vector<std::thread> pool;
+                for (std::size_t t = 0; t < threads; ++t)
+                    pool.emplace_back(worker, std::ref(trues[t]));
+                for (auto &t: pool)
+                    t.join();
+            });
+
+            const auto rate = static_cast<double>(threads * iters) * 1e9 / ns;
+            if (threads == 1) singleRate = rate;
+
+            const bool ok = std::all_of(trues.begin(), trues.end(), [&](auto n) { return n == expected; });
+            std::printf("evals/sec %.0f, scaling %.2fx over 1 thread (%.0f%% efficiency), results %s\n",
+                        rate, rate / singleRate, 100.0 * rate / singleRate / static_cast<double>(threads),
+                        ok ? "match" : "DIFFER");
+        }
+    }
+    std::printf("\n");
+}
+
+static void benchBatchInput() {
+    constexpr std::size_t lines = 40000;
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+
+    // One corpus expression per line, cycling through the corpus
+    const auto entries = corpus();
+    const auto path = (std::filesystem::temp_directory_path() / "expr-eval-bench-input.txt").string();
+    {
+        std::ofstream file{path, std::ios::binary};
+        for (std::size_t i = 0; i < lines; ++i)
+            file << entries[i % entries.size()].src << '\n';
+    }
+
+#if defined(_WIN32)
+    std::FILE *sink = std::fopen("NUL", "wb");
+#else
+    std::FILE *sink = std::fopen("/dev/null", "wb");
+#endif
+
+    const auto inputBytes = static_cast<double>(std::filesystem::file_size(path));
+    auto report = [&](const double ns) {
+        std::printf("expr/sec %.0f, MiB/sec %.1f\n", lines * 1e9 / ns, inputBytes / (1 << 20) * 1e9 / ns);
+    };
+
+    std::printf("== %zu lines, output discarded ==\n", lines);
+    StreamRunner runner{ip.symbols(), ip.makeContext()};
+
+    report(runBench("iostream: pipelined stages", 1, [&] {
+        std::ifstream in{path, std::ios::binary};
+        doNotOptimize(runner.run(in, sink).expressions);
+    }));
+
+    const std::size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool pool{threads};
+        report(runBench(std::format("mapped: {} workers", threads), 1, [&] {
+            const MappedFile file{path};
+            doNotOptimize(runner.run(file, sink, pool).expressions);
+        }));
+    }
+
+    std::fclose(sink);
+    std::filesystem::remove(path);
+    std::printf("\n");
+}
+
+static void benchExprPack() {
+    constexpr std::size_t count = 50000;
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+    ip.setEngine(Engine::BYTECODE);
+
+    // A rule set of distinct expressions built from the corpus shapes
+    const auto entries = corpus();
+    std::vector<std::string> sources;
+    sources.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+        sources.push_back(std::format("{} || x > {}", entries[i % entries.size()].src, i));
+
+    std::printf("== %zu expressions ==\n", count);
+
+    std::vector<CompiledExpr> exprs;
+    const auto parseNs = runBench("parse from text", 1, [&] {
+        exprs.clear();
+        exprs.reserve(count);
+        for (const auto &src: sources)
+            exprs.push_back(ip.compile(src));
+    });
+
+    const auto path = (std::filesystem::temp_directory_path() / "expr-eval-bench-pack.bin").string();
+    runBench("save to binary", 1, [&] { ExprPack::save(path, exprs, ip.symbols()); });
+
+    std::optional<ExprPack> pack;
+    const auto loadNs = runBench("load from binary (mmap + validate)", 1, [&] {
+        pack.emplace(ExprPack::load(path, ip.symbols()));
+    });
+
+    // Both must agree on every result
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (exprs[i].eval(ip.values()).toString() != pack->eval(i, ip.values()).toString())
+            ++mismatches;
+    }
+
+    std::printf("file %.1f MiB, load %.1fx faster than parsing, results %s\n\n",
+                static_cast<double>(std::filesystem::file_size(path)) / (1 << 20), parseNs / loadNs,
+                mismatches == 0 ? "match" : "DIFFER");
+
+    pack.reset();
+    std::filesystem::remove(path);
+}
+
+static void benchProfiler() {
+    constexpr std::size_t iters = 100000;
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+
+    std::printf("== tree walker with and without per-node profiling ==\n");
+    for (const auto &[kind, src]: corpus()) {
+        const auto expr = ip.compile(src);
+        Profiler profiler{expr.program()};
+
+        const auto plainNs = runBench(std::format("{}: Program::eval", kind), iters, [&] {
+            doNotOptimize(expr.program().eval(ip.values()));
+        });
+        const auto profiledNs = runBench(std::format("{}: Profiler::eval", kind), iters / 10, [&] {
+            doNotOptimize(profiler.eval(ip.values()));
+        });
+
+        std::printf("profiling costs %.1fx\n", profiledNs / plainNs);
+    }
+    std::printf("\n");
+}
+
+static void benchTracing() {
+    constexpr std::size_t iters = 200000;
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+    ip.setCacheCapacity(0); // parse on every Interpreter::eval
+    const auto expr = ip.compile("price * qty > 100");
+
+    std::printf("== TRACE_SCOPE cost, disabled and enabled ==\n");
+    for (const bool enabled: {false, true}) {
+        const char *state = enabled ? "enabled" : "disabled";
+        if (enabled) Tracer::enable();
+
+        runBench(std::format("tracing {}: Program::eval", state), iters, [&] {
+            doNotOptimize(expr.eval(ip.values()));
+        });
+        runBench(std::format("tracing {}: Interpreter::eval (uncached)", state), iters / 10, [&] {
+            doNotOptimize(ip.eval("price * qty > 100"));
+        });
+
+        Tracer::disable();
+    }
+    Tracer::clear();
+    std::printf("\n");
+}
+
+// Balanced sum of `terms` products over v0..v47, so every variable
+// feeds many leaves and any path to the root is short
+static std::string balancedSum(const std::size_t begin, const std::size_t end) {
+    if (end - begin == 1)
+        return std::format("v{} * {}", begin % 48, begin % 7 + 1);
+
+    const auto mid = begin + (end - begin) / 2;
+    return std::format("({} + {})", balancedSum(begin, mid), balancedSum(mid, end));
+}
+
+static void benchIncremental() {
+    constexpr std::size_t iters = 2000;
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+
+    std::printf("== one input changes per evaluation ==\n");
+    for (const auto &[kind, src]: std::vector<std::pair<std::string, std::string> >{
+             {"balanced, 1024 terms", balancedSum(0, 1024)},
+             {"left-deep, 48 vars", corpus()[6].src},
+         }) {
+        const auto expr = ip.compile(src);
+        IncrementalExpr incremental{expr};
+        ip.setEngine(Engine::JIT);
+        const auto jit = ip.compile(src);
+        ip.setEngine(Engine::TREE_WALKER);
+
+        std::vector<std::size_t> slots;
+        for (int v = 0; v < 48; ++v)
+            slots.push_back(ip.slotOf(std::format("v{}", v)));
+
+        std::size_t i = 0;
+        auto change = [&] {
+            ++i;
+            ip.setVar(slots[i % 48], RuntimeVar(static_cast<double>(i % 11)));
+        };
+
+        const auto fullNs = runBench(std::format("{}: full tree walk", kind), iters, [&] {
+            change();
+            doNotOptimize(ip.eval(expr));
+        });
+        runBench(std::format("{}: jit", kind), iters, [&] {
+            change();
+            doNotOptimize(ip.eval(jit));
+        });
+
+        ip.eval(incremental);
+        const auto before = incremental.stats();
+        const auto incNs = runBench(std::format("{}: incremental", kind), iters, [&] {
+            change();
+            doNotOptimize(ip.eval(incremental));
+        });
+
+        const auto nodes = static_cast<double>(incremental.stats().evaluated - before.evaluated) / iters;
+        const bool same = ip.eval(incremental).toString() == ip.eval(expr).toString();
+        std::printf("%.0f nodes recomputed per eval, %.1fx over the full walk, results %s\n",
+                    nodes, fullNs / incNs, same ? "match" : "DIFFER");
+    }
+    std::printf("\n");
+}
+
+static void benchFormulaGraph() {
+    constexpr std::size_t columns = 64, rows = 64, iters = 200;
+
+    // `columns` independent running sums, each `rows` formulas deep
+    Interpreter ip;
+    FormulaGraph graph{ip};
+    std::vector<std::string> names, sources;
+    for (std::size_t c = 0; c < columns; ++c) {
+        ip.addVar(std::format("in{}", c), RuntimeVar(static_cast<double>(c)));
+        for (std::size_t r = 0; r < rows; ++r) {
+            names.push_back(std::format("c{}r{}", c, r));
+            sources.push_back(r == 0
+                                  ? std::format("in{} * 2", c)
+                                  : std::format("c{}r{} + in{} * {} > 1000 ? 0 : c{}r{} + {}", c, r - 1, c, r, c, r - 1, r));
+        }
+    }
+    // Define back to front so every formula starts as a forward reference
+    for (std::size_t i = names.size(); i-- > 0;)
+        graph.define(names[i], sources[i]);
+
+    std::vector<std::size_t> slots;
+    std::vector<CompiledExpr> exprs;
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        slots.push_back(ip.slotOf(names[i]));
+        exprs.push_back(ip.compile(sources[i]));
+    }
+    std::vector<std::size_t> inputs;
+    for (std::size_t c = 0; c < columns; ++c)
+        inputs.push_back(ip.slotOf(std::format("in{}", c)));
+
+    std::printf("== %zu formulas, %zu levels ==\n", names.size(), graph.levels().size());
+
+    std::size_t i = 0;
+    auto changeOne = [&] {
+        ++i;
+        ip.setVar(inputs[i % columns], RuntimeVar(static_cast<double>(i % 13)));
+    };
+
+    const auto allNs = runBench("one input changed: recompute all, in order", iters, [&] {
+        changeOne();
+        for (std::size_t f = 0; f < exprs.size(); ++f)
+            ip.setVar(slots[f], ip.eval(exprs[f]));
+    });
+    graph.recompute();
+    const auto graphNs = runBench("one input changed: FormulaGraph::recompute", iters, [&] {
+        changeOne();
+        doNotOptimize(graph.recompute());
+    });
+
+    // Every column changes, so each level is a full batch of work
+    auto changeAll = [&] {
+        ++i;
+        for (const auto slot: inputs)
+            ip.setVar(slot, RuntimeVar(static_cast<double>(i % 13)));
+    };
+    ThreadPool pool;
+    const auto serialNs = runBench("all inputs changed: recompute, serial", iters / 10, [&] {
+        changeAll();
+        doNotOptimize(graph.recompute());
+    });
+    const auto parallelNs = runBench(std::format("all inputs changed: recompute, {} threads", pool.size()), iters / 10, [&] {
+        changeAll();
+        doNotOptimize(graph.recompute(pool));
+    });
+
+    // The graph's values must match a straight in-order evaluation
+    changeOne();
+    graph.recompute();
+    std::vector<std::string> fromGraph;
+    for (const auto slot: slots)
+        fromGraph.push_back(ip.getVar(slot).toString());
+
+    bool same = true;
+    for (std::size_t f = 0; f < exprs.size(); ++f) {
+        ip.setVar(slots[f], ip.eval(exprs[f]));
+        same = same && ip.getVar(slots[f]).toString() == fromGraph[f];
+    }
+
+    std::printf("dependency tracking %.1fx over recompute-all, %zu threads %.1fx over serial, results %s\n\n",
+                allNs / graphNs, pool.size(), serialNs / parallelNs, same ? "match" : "DIFFER");
+}
+
+static void benchExprDag() {
+    constexpr std::size_t count = 5000, iters = 50;
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+
+    // Rules that repeat a few heavy subexpressions with their own thresholds
+    const std::string shared[] = {
+        "price * qty * (1 - discount) + shipping",
+        corpus()[6].src,
+        "(x - 3) * (x + 3) % 7",
+    };
+    std::vector<CompiledExpr> exprs;
+    for (std::size_t i = 0; i < count; ++i)
+        exprs.push_back(ip.compile(std::format("({}) > {} || qty > {}", shared[i % 3], i % 97, i % 13)));
+
+    std::optional<ExprDag> dag;
+    runBench("build DAG", 1, [&] { dag.emplace(exprs); });
+    const auto &stats = dag->stats();
+
+    std::printf("== %zu rules: %zu tree nodes, %zu DAG nodes (%zu shared) ==\n",
+                count, stats.treeNodes, stats.dagNodes, stats.sharedNodes);
+
+    std::vector<RuntimeVar> fromTrees(count), fromDag(count);
+    const auto treeNs = runBench("separate Programs", iters, [&] {
+        for (std::size_t i = 0; i < count; ++i)
+            fromTrees[i] = exprs[i].eval(ip.values());
+    });
+    const auto dagNs = runBench("shared DAG", iters, [&] {
+        doNotOptimize(dag->eval(ip.values(), fromDag));
+    });
+
+    bool same = true;
+    for (std::size_t i = 0; i < count; ++i)
+        same = same && fromTrees[i].toString() == fromDag[i].toString();
+
+    std::printf("memory %.1f KiB -> %.1f KiB, %.1fx faster per pass, results %s\n\n",
+                static_cast<double>(stats.treeBytes) / 1024, static_cast<double>(stats.dagBytes) / 1024,
+                treeNs / dagNs, same ? "match" : "DIFFER");
+}
+
+static void benchTyped() {
+    constexpr std::size_t iters = 200000;
+
+    Interpreter ip;
+    declareCorpusVars(ip);
+    ip.setEngine(Engine::BYTECODE);
+
+    std::string decls = "x: number, price: number, qty: number, discount: number, shipping: number, "
+                        "budget: number, stock: number, vip: bool, f_name: string, l_name: string";
+    for (int i = 0; i < 48; ++i)
+        decls += std::format(", v{}: number", i);
+    const auto schema = Schema::parse(decls, ip.symbols());
+
+    std::printf("== bytecode with and without declared types ==\n");
+    for (const auto &[kind, src]: corpus()) {
+        const auto checked = ip.compile(src);
+        const auto typed = ip.compile(src, schema);
+
+        const auto checkedNs = runBench(std::format("{}: checked", kind), iters, [&] {
+            doNotOptimize(ip.eval(checked));
+        });
+        const auto typedNs = runBench(std::format("{}: typed", kind), iters, [&] {
+            doNotOptimize(ip.eval(typed));
+        });
+
+        const bool same = ip.eval(checked).toString() == ip.eval(typed).toString();
+        std::printf("%s result, typed %.2fx, results %s\n", std::string{staticTypeStr(typed.resultType())}.c_str(),
+                    checkedNs / typedNs, same ? "match" : "DIFFER");
+    }
+    std::printf("\n");
+}
+
+// ----- DRIVER ----- //
+static void usage(const char *argv0) {
+    std::fprintf(stderr, "usage: %s [--filter TEXT] [--json PATH] [--list]\n"
+                 "  --filter TEXT  only run groups whose name contains TEXT\n"
+                 "  --json PATH    also write all results as JSON to PATH\n"
+                 "  --list         print the group names and exit\n", argv0);
+}
+
+int main(const int argc, char **argv) {
+    const std::vector<std::pair<std::string, void (*)()> > groups{
+        {"frontend", benchFrontend},
+        {"program-eval", benchProgramEval},
+        {"runtime-ops", benchRuntimeOps},
+        {"end-to-end", benchEndToEnd},
+        {"compile-once", benchCompileOnce},
+        {"expr-cache", benchExprCache},
+        {"slot-updates", benchSlotUpdates},
+        {"engines", benchEngines},
+        {"jit", benchJit},
+        {"short-circuit", benchShortCircuit},
+        {"string-concat", benchStringConcat},
+        {"optimizer", benchOptimizer},
+        {"arena", benchArena},
+        {"lexer", benchLexer},
+        {"batch", benchBatch},
+        {"parallel-batch", benchParallelBatch},
+        {"concurrency", benchConcurrency},
+        {"batch-input", benchBatchInput},
+        {"expr-pack", benchExprPack},
+        {"profiler", benchProfiler},
+        {"tracing", benchTracing},
+        {"incremental", benchIncremental},
+        {"formula-graph", benchFormulaGraph},
+        {"expr-dag", benchExprDag},
+        {"typed", benchTyped},
+    };
+
+    std::string filter, jsonPath;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (arg == "--list") {
+            for (const auto &[name, fn]: groups)
+                std::printf("%s\n", name.c_str());
+            return 0;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    for (const auto &[name, fn]: groups) {
+        if (name.find(filter) == std::string::npos)
+            continue;
+
+        setBenchGroup(name);
+        fn();
+    }
+
+    if (!jsonPath.empty()) {
+        std::ofstream out{jsonPath};
+        out << benchResultsJson().serialize(true);
+        if (!out) {
+            std::fprintf(stderr, "could not write %s\n", jsonPath.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "runtime.h"
+#include "ops.h"
+#include "../frontend/ast.h"
+
+class ThreadPool;
+class EvalContext;
+
+// Columnar evaluation of a numeric expression over many rows at once.
+//
+// The AST is flattened into a list of steps, each applying one operator
+// to whole blocks of rows in a tight loop the compiler can vectorize.
+// Only number-valued inputs are supported; comparisons and logical
+// operators produce 1.0 (true) or 0.0 (false).
+class BatchProgram {
+public:
+    // Rows processed per step; sized so the scratch columns stay in cache
+    static constexpr std::size_t kBlockRows = 1024;
+
+    // Throws if `program` uses strings, nil, or mixes bools into
+    // arithmetic, i.e. anything the scalar interpreter would not accept
+    // as a number expression.
+    explicit BatchProgram(const Program &program);
+
+    // `columns` is indexed by SymbolTable slot. A slot with an empty span
+    // is read from `scalars` and broadcast to every row; otherwise the
+    // column must hold at least out.size() values.
+    void eval(std::span<const std::span<const double> > columns,
+              std::span<const RuntimeVar> scalars,
+              std::span<double> out) const;
+
+    // Same, taking broadcast values from `ctx` and reusing its scratch
+    // buffer, so steady-state evaluation does not allocate
+    void eval(std::span<const std::span<const double> > columns,
+              std::span<double> out,
+              EvalContext &ctx) const;
+
+    // Split the rows into morsels of `morselRows` and evaluate them on
+    // `pool`. Every worker uses its own scratch columns; the program
+    // itself is only read.
+    void evalParallel(std::span<const std::span<const double> > columns,
+                      std::span<const RuntimeVar> scalars,
+                      std::span<double> out,
+                      ThreadPool &pool,
+                      std::size_t morselRows = 16 * kBlockRows) const;
+
+    // True when the result column holds 1.0/0.0 booleans
+    [[nodiscard]] bool resultIsBool() const;
+
+    // Scratch doubles needed per block (temporaries between steps)
+    [[nodiscard]] std::size_t scratchColumns() const;
+
+private:
+    struct Operand {
+        enum class Kind : std::uint8_t {
+            CONST, // `value`
+            VAR, // column or scalar for `index` (a slot)
+            TEMP // scratch column `index`
+        } kind;
+
+        std::uint32_t index = 0;
+        double value = 0.0;
+    };
+
+    struct Step {
+        BinaryOp op;
+        Operand lhs, rhs;
+        std::uint32_t dst; // scratch column
+    };
+
+    enum class Kind : std::uint8_t { NUMBER, BOOL };
+
+    Operand compileNode(const Node &node, std::uint32_t depth, Kind &kind);
+
+    void checkColumns(std::span<const std::span<const double> > columns, std::size_t rows) const;
+
+    // Evaluate rows [begin, end) using `scratch` for temporaries
+    void evalRows(std::span<const std::span<const double> > columns,
+                  std::span<const RuntimeVar> scalars,
+                  std::span<double> out,
+                  std::size_t begin, std::size_t end,
+                  std::vector<double> &scratch) const;
+
+    std::vector<Step> m_steps;
+    Operand m_result{};
+    Kind m_resultKind = Kind::NUMBER;
+    std::size_t m_scratch = 0;
+};
+
+#endif // BATCH_H
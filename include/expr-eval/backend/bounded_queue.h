@@ -0,0 +1,69 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Blocking FIFO with a fixed capacity, connecting one pipeline stage to
+// the next. A full queue stalls the producer, so a slow stage throttles
+// the ones before it instead of buffering without bound.
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(const std::size_t capacity) : m_capacity(capacity == 0 ? 1 : capacity) {}
+
+    BoundedQueue(const BoundedQueue &) = delete;
+
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    // Blocks while the queue is full. Returns false, dropping `item`, if
+    // the queue was closed.
+    bool push(T item) {
+        std::unique_lock lock{m_mutex};
+        m_notFull.wait(lock, [&] { return m_items.size() < m_capacity || m_closed; });
+        if (m_closed)
+            return false;
+
+        m_items.push_back(std::move(item));
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks until an item is available; nullopt once the queue is
+    // closed and drained.
+    std::optional<T> pop() {
+        std::unique_lock lock{m_mutex};
+        m_notEmpty.wait(lock, [&] { return !m_items.empty() || m_closed; });
+        if (m_items.empty())
+            return std::nullopt;
+
+        T item = std::move(m_items.front());
+        m_items.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        return item;
+    }
+
+    // No more pushes; consumers still drain what is queued
+    void close() {
+        {
+            std::lock_guard lock{m_mutex};
+            m_closed = true;
+        }
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+private:
+    std::size_t m_capacity;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty, m_notFull;
+    std::deque<T> m_items;
+    bool m_closed = false;
+};
+
+#endif // BOUNDED_QUEUE_H
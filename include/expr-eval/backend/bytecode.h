@@ -0,0 +1,105 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "runtime.h"
+#include "../frontend/ast.h"
+#include "../frontend/type_checker.h"
+
+// ----- OPCODES ----- //
+enum class OpCode : std::uint8_t {
+    // Operands
+    PUSH_NUM, // push `num`
+    PUSH_CONST, // push constants[arg]
+    PUSH_TRUE,
+    PUSH_FALSE,
+    PUSH_NIL,
+    LOAD_VAR, // push slots[arg]
+
+    BINARY, // pop two, push binaryKernels(BinaryOp(arg))(l, r)
+
+    // Control flow; `arg` is the index of the target instruction
+    JUMP,
+    JUMP_IF_FALSE, // pop, jump if falsy
+    JUMP_IF_FALSE_OR_POP, // `&&`: if falsy, replace the top with false and jump; else pop
+    JUMP_IF_TRUE_OR_POP, // `||`: if truthy, replace the top with true and jump; else pop
+    TO_BOOL, // replace the top with its truthiness
+
+    POP,
+    RETURN,
+
+    // Typed forms of BINARY for operands whose types the TypeChecker
+    // proved; they skip the type dispatch. Appended so that ExprPack
+    // files keep their opcode values.
+    ADD_NUM,
+    SUB_NUM,
+    MUL_NUM,
+    DIV_NUM,
+    MOD_NUM,
+    EQ_NUM,
+    NEQ_NUM,
+    LT_NUM,
+    LT_EQ_NUM,
+    GT_NUM,
+    GT_EQ_NUM,
+    CONCAT // string + string
+};
+
+struct Instr {
+    OpCode op;
+    std::uint32_t arg = 0;
+    double num = 0.0;
+};
+
+// ExprPack stores Instr records as-is and runs them in place
+static_assert(sizeof(Instr) == 16 && offsetof(Instr, arg) == 4 && offsetof(Instr, num) == 8);
+
+// ----- CHUNK ----- //
+// Linear bytecode for a single Program, run by the VM.
+struct Chunk {
+    std::vector<Instr> code;
+    std::vector<RuntimeVar> constants;
+    std::size_t maxStack = 0;
+};
+
+// Non-owning view of bytecode that may live outside a Chunk, e.g. in
+// the mapped file of an ExprPack
+struct ChunkView {
+    const Instr *code;
+    const RuntimeVar *constants;
+    std::size_t maxStack;
+};
+
+// ----- COMPILER ----- //
+// Lowers a Program AST into a Chunk, post-order, so that operands are
+// always pushed before the op that consumes them.
+class BytecodeCompiler {
+public:
+    // With `types` (having checked `program`), operators on operands of
+    // known types compile to the typed opcodes. The chunk then relies on
+    // the variables holding their declared types.
+    static Chunk compile(const Program &program, const TypeChecker *types = nullptr);
+
+private:
+    // Typed opcode for `op` on `l` and `r`, or BINARY
+    static OpCode typedOp(BinaryOp op, StaticType l, StaticType r);
+
+    [[nodiscard]] StaticType typeOf(const Node &node) const;
+
+    void emitNode(const Node &node);
+
+    void emit(OpCode op, std::uint32_t arg = 0, double num = 0.0);
+
+    // Point the jump at `at` to the next instruction to be emitted
+    void patch(std::size_t at);
+
+    Chunk m_chunk;
+    std::size_t m_depth = 0;
+    const TypeChecker *m_types = nullptr;
+};
+
+#endif // BYTECODE_H
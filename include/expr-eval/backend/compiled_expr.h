@@ -0,0 +1,88 @@
+#ifndef COMPILED_EXPR_H
+#define COMPILED_EXPR_H
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "runtime.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "eval_context.h"
+#include "../frontend/ast.h"
+#include "../frontend/optimizer.h"
+#include "../frontend/type_checker.h"
+#include "../picojson.h"
+
+// Evaluation strategy used by the Interpreter and CompiledExpr
+enum class Engine {
+    TREE_WALKER, // recursive Node::eval
+    BYTECODE, // BytecodeCompiler + VM
+    JIT // native code where JitCompiler supports it, else TREE_WALKER
+};
+
+// A parsed expression that can be evaluated many times without
+// re-running the lexer and parser. The AST, bytecode and native code are
+// immutable and shared, so copies of a CompiledExpr are cheap and one
+// instance can be evaluated from any number of threads without locks.
+class CompiledExpr {
+public:
+    CompiledExpr(std::string src, std::shared_ptr<const Program> program,
+                 Engine engine = Engine::TREE_WALKER, OptimizerStats stats = {});
+
+    // Typed bytecode for a Program that `types` has just checked. Each
+    // evaluation first verifies that the variables hold their declared
+    // types, once per variable instead of once per operator.
+    CompiledExpr(std::string src, std::shared_ptr<const Program> program,
+                 const TypeChecker &types, OptimizerStats stats = {});
+
+    // `slots` holds the variable values, indexed by the SymbolTable
+    // slots the expression was compiled against; throws if it is shorter
+    // than the highest slot the expression reads
+    RuntimeVar eval(std::span<const RuntimeVar> slots) const;
+
+    // Evaluate with the values and scratch buffers of `ctx`
+    RuntimeVar eval(EvalContext &ctx) const;
+
+    [[nodiscard]] const std::string &source() const;
+
+    [[nodiscard]] Engine engine() const;
+
+    // What the optimizer did to this expression at compile time
+    [[nodiscard]] const OptimizerStats &optimizerStats() const;
+
+    [[nodiscard]] const Program &program() const;
+
+    // Inferred result type of a typed expression, ANY for untyped ones
+    [[nodiscard]] StaticType resultType() const;
+
+    // Native code for Engine::JIT, or nullptr if the expression fell
+    // back to the tree walker
+    [[nodiscard]] const JitCode *jit() const;
+
+    [[nodiscard]] picojson::value dump() const;
+
+private:
+    // Tree walker, or native code for Engine::JIT when it applies
+    RuntimeVar evalTree(std::span<const RuntimeVar> slots) const;
+
+    // Throws if `slots` ends before the highest slot the expression reads,
+    // e.g. a context made before a variable was added
+    void checkSlots(std::span<const RuntimeVar> slots) const;
+
+    // Throws unless every input of a typed expression has its declared type
+    void checkInputs(std::span<const RuntimeVar> slots) const;
+
+    std::string m_src;
+    Engine m_engine;
+    OptimizerStats m_stats;
+    std::shared_ptr<const Program> m_program;
+    std::size_t m_slotCount; // Program::slotCount(), checked on every eval
+    std::shared_ptr<const Chunk> m_chunk; // only set for Engine::BYTECODE
+    std::shared_ptr<const JitCode> m_jit; // only set for Engine::JIT
+    std::shared_ptr<const std::vector<TypeChecker::Input> > m_inputs; // only set for typed bytecode
+    StaticType m_resultType = StaticType::ANY;
+};
+
+#endif // COMPILED_EXPR_H
@@ -0,0 +1,48 @@
+#ifndef EVAL_CONTEXT_H
+#define EVAL_CONTEXT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "runtime.h"
+#include "vm.h"
+
+// Mutable per-thread evaluation state: variable values indexed by
+// SymbolTable slot, plus the scratch buffers the engines reuse between
+// runs. Compiled expressions are immutable and can be shared freely;
+// each thread evaluating them brings its own EvalContext.
+class EvalContext {
+public:
+    EvalContext() = default;
+
+    // Start from a copy of `values`, e.g. Interpreter::values()
+    explicit EvalContext(std::span<const RuntimeVar> values);
+
+    // Grows the value array as needed; new slots start out nil
+    void set(std::size_t slot, RuntimeVar value);
+
+    [[nodiscard]] const RuntimeVar &get(std::size_t slot) const;
+
+    [[nodiscard]] std::span<const RuntimeVar> values() const;
+
+    // Per-slot write stamps, parallel to values(). Every write gets a
+    // stamp that is unique across all contexts, so an unchanged stamp
+    // means an unchanged value; IncrementalExpr relies on this.
+    [[nodiscard]] std::span<const std::uint64_t> versions() const;
+
+    // Operand stack for Engine::BYTECODE
+    VM &vm();
+
+    // Temporaries for BatchProgram
+    std::vector<double> &batchScratch();
+
+private:
+    std::vector<RuntimeVar> m_values;
+    std::vector<std::uint64_t> m_versions;
+    VM m_vm;
+    std::vector<double> m_batchScratch;
+};
+
+#endif // EVAL_CONTEXT_H
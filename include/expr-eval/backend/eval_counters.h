@@ -0,0 +1,19 @@
+#ifndef EVAL_COUNTERS_H
+#define EVAL_COUNTERS_H
+
+#include <cstdint>
+
+// Work done by lazy operators (`&&`, `||`, `?:`), counted by both the
+// tree walker and the VM
+struct EvalCounters {
+    std::uint64_t branches = 0; // lazy operators evaluated
+    std::uint64_t skipped = 0; // operand subtrees that were never evaluated
+};
+
+// Counters of the calling thread; assign `{}` to reset them
+inline EvalCounters &evalCounters() {
+    thread_local EvalCounters counters;
+    return counters;
+}
+
+#endif // EVAL_COUNTERS_H
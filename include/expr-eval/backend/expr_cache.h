@@ -0,0 +1,65 @@
+#ifndef EXPR_CACHE_H
+#define EXPR_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string_view>
+#include <unordered_map>
+
+#include "compiled_expr.h"
+
+struct ExprCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+};
+
+// Bounded LRU map from source text to its CompiledExpr
+class ExprCache {
+public:
+    static constexpr std::size_t kDefaultCapacity = 128;
+
+    explicit ExprCache(std::size_t capacity = kDefaultCapacity);
+
+    // Return the cached expression for `src` and mark it most recently
+    // used, or nullptr. Counts a hit or a miss.
+    const CompiledExpr *find(std::string_view src);
+
+    // Insert `expr` keyed by its source, evicting the least recently used
+    // entry when full. The reference stays valid until the next insert
+    // or until it is evicted.
+    const CompiledExpr &insert(CompiledExpr expr);
+
+    void clear();
+
+    // Shrinking below the current size evicts from the cold end
+    void setCapacity(std::size_t capacity);
+
+    [[nodiscard]] std::size_t capacity() const;
+
+    [[nodiscard]] std::size_t size() const;
+
+    [[nodiscard]] const ExprCacheStats &stats() const;
+
+private:
+    struct Hash {
+        using is_transparent = void;
+
+        std::size_t operator()(const std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    void evictTo(std::size_t size);
+
+    std::size_t m_capacity;
+    ExprCacheStats m_stats;
+
+    // Front is the most recently used; keys view the entries' sources
+    std::list<CompiledExpr> m_entries;
+    std::unordered_map<std::string_view, std::list<CompiledExpr>::iterator, Hash, std::equal_to<> > m_index;
+};
+
+#endif // EXPR_CACHE_H
@@ -0,0 +1,92 @@
+#ifndef EXPR_DAG_H
+#define EXPR_DAG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "compiled_expr.h"
+#include "ops.h"
+#include "runtime.h"
+#include "../frontend/ast.h"
+
+struct DagStats {
+    std::size_t exprs = 0;
+    std::size_t treeNodes = 0; // AST nodes over all separate Programs
+    std::size_t dagNodes = 0; // distinct nodes after hash-consing
+    std::size_t sharedNodes = 0; // operator nodes with more than one parent, memoized
+    std::size_t treeBytes = 0; // arena bytes of the separate Programs
+    std::size_t dagBytes = 0; // node table, memo state and root lists
+};
+
+// Many expressions compiled into one DAG. Structurally identical
+// subtrees, e.g. `x * PI` in hundreds of rules, are hash-consed into a
+// single node, so a pass over the whole set evaluates each of them once.
+//
+// Evaluation is demand driven in expression order, with the semantics
+// of Program::eval: `&&`, `||` and `?:` still only evaluate what they
+// need, so a shared node under a branch that is never taken is never
+// computed. An operator node with several parents memoizes its value
+// for the rest of the pass. Hash-consing is purely structural; `a * b` and `b * a`
+// stay distinct nodes.
+//
+// Holds mutable memo state: use one ExprDag per thread.
+class ExprDag {
+public:
+    // The expressions must have been compiled against the same
+    // SymbolTable; the DAG keeps no reference to them
+    explicit ExprDag(std::span<const CompiledExpr> exprs);
+
+    // Evaluate every expression; out[i] receives the value of exprs[i].
+    // An expression that throws yields nil and its message is kept in
+    // error(i). Returns the number of failed expressions. Throws if
+    // `slots` does not reach the highest slot any expression reads.
+    std::size_t eval(std::span<const RuntimeVar> slots, std::span<RuntimeVar> out);
+
+    [[nodiscard]] std::size_t size() const;
+
+    // Error message of expression `i` in the last eval, empty if none
+    [[nodiscard]] const std::string &error(std::size_t i) const;
+
+    [[nodiscard]] const DagStats &stats() const;
+
+private:
+    static constexpr std::uint32_t kNone = static_cast<std::uint32_t>(-1);
+
+    struct DagNode {
+        explicit DagNode(const NodeType type) : type(type) {
+        }
+
+        NodeType type;
+        BinaryOp op = BinaryOp::ADD;
+        bool shared = false; // memoized within a pass
+        std::uint32_t children[3] = {kNone, kNone, kNone}; // left/right or cond/then/else
+        std::size_t slot = 0; // IDENT_LIT
+        RuntimeVar value; // literals
+    };
+
+    // Per-node memo for the current pass
+    struct Memo {
+        std::uint64_t pass = 0;
+        RuntimeVar value;
+    };
+
+    class Builder;
+
+    RuntimeVar evalNode(std::uint32_t id, std::span<const RuntimeVar> slots);
+
+    RuntimeVar compute(const DagNode &node, std::span<const RuntimeVar> slots);
+
+    std::vector<DagNode> m_nodes; // children always precede parents
+    std::vector<Memo> m_memo;
+    std::vector<std::vector<std::uint32_t> > m_roots; // statements per expression
+    std::vector<std::string> m_errors;
+    std::uint64_t m_pass = 0;
+    std::size_t m_slotCount = 0; // one past the highest slot read
+
+    DagStats m_stats;
+};
+
+#endif // EXPR_DAG_H
@@ -0,0 +1,74 @@
+#ifndef EXPR_PACK_H
+#define EXPR_PACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bytecode.h"
+#include "compiled_expr.h"
+#include "eval_context.h"
+#include "mapped_file.h"
+#include "../frontend/symbols.h"
+
+// A set of expressions saved as bytecode in a compact binary file, so a
+// service can start without parsing its rules. Loading maps the file and
+// validates it; the instructions and source texts are then used in place.
+//
+// Layout (native byte order, every section 8-byte aligned):
+//   header | symbol names | expression table | constants | Instr[] | string bytes
+// The header records the format version, byte order and sizeof(Instr),
+// so a file written by an incompatible build is rejected, not misread.
+class ExprPack {
+public:
+    static constexpr std::uint32_t kVersion = 1;
+
+    // Write `exprs`, compiled against `symbols`, to `path`. The engine an
+    // expression was compiled for does not matter; packs always hold
+    // bytecode. Throws std::runtime_error on I/O errors.
+    static void save(const std::string &path, std::span<const CompiledExpr> exprs, const SymbolTable &symbols);
+
+    // Map `path` and check it: header, section bounds, a checksum over
+    // the body, and every instruction's operands and stack effect, so a
+    // corrupt file can never make the VM read out of bounds. Variables
+    // are resolved by name against `symbols`; each one must be declared
+    // there. Throws std::runtime_error if anything does not check out.
+    static ExprPack load(const std::string &path, const SymbolTable &symbols);
+
+    [[nodiscard]] std::size_t size() const;
+
+    // Source text of expression `i`, viewing the mapped file
+    [[nodiscard]] std::string_view source(std::size_t i) const;
+
+    // Like CompiledExpr::eval; throws if `slots` does not reach the
+    // highest slot expression `i` reads
+    RuntimeVar eval(std::size_t i, std::span<const RuntimeVar> slots) const;
+
+    RuntimeVar eval(std::size_t i, EvalContext &ctx) const;
+
+    // True if the slots in the file differed from `symbols` and the code
+    // had to be copied to renumber them
+    [[nodiscard]] bool relocated() const;
+
+private:
+    struct Entry {
+        ChunkView chunk;
+        std::string_view source;
+        std::size_t slotCount; // one past the highest slot the code reads
+    };
+
+    explicit ExprPack(MappedFile file);
+
+    // Entry `i`, after checking that `slots` is long enough for it
+    const Entry &entry(std::size_t i, std::span<const RuntimeVar> slots) const;
+
+    MappedFile m_file;
+    std::vector<Entry> m_entries;
+    std::vector<RuntimeVar> m_constants; // string constants have to be materialized
+    std::vector<Instr> m_relocatedCode; // empty unless relocated()
+};
+
+#endif // EXPR_PACK_H
@@ -0,0 +1,87 @@
+#ifndef FORMULA_GRAPH_H
+#define FORMULA_GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "compiled_expr.h"
+#include "interpreter.h"
+#include "thread_pool.h"
+
+struct RecomputeStats {
+    std::size_t recomputed = 0; // formulas evaluated
+    std::size_t unchanged = 0; // formulas whose inputs had not changed
+    std::size_t errors = 0; // formulas that failed to evaluate
+    std::size_t levels = 0; // topological levels in the graph
+};
+
+// Named formulas over an Interpreter's variables, spreadsheet style.
+// `define("total", "price * qty")` makes `total` a variable whose value
+// is kept up to date by recompute(); formulas may refer to variables
+// and to each other in any order, as long as there is no cycle.
+//
+// Formulas are grouped into topological levels: a formula only reads
+// variables and formulas of lower levels, so the formulas of one level
+// are independent and can be evaluated in parallel. recompute() visits
+// the levels in order and re-evaluates only formulas with an input whose
+// write stamp (EvalContext::versions) changed, so a change flows exactly
+// to the formulas downstream of it. Results are written back with
+// Interpreter::setVar, where every expression reads them.
+class FormulaGraph {
+public:
+    // `ip` must outlive the graph
+    explicit FormulaGraph(Interpreter &ip);
+
+    // Add or replace the formula for `name`. Identifiers in `src` that
+    // are not yet declared are declared as nil variables, so formulas
+    // can be defined before the ones they use. Throws std::runtime_error
+    // on a parse error or if the definition would close a cycle; the
+    // graph is then left unchanged, though names it declared stay declared.
+    void define(const std::string &name, const std::string &src);
+
+    // Bring every formula up to date, serially or on `pool`
+    RecomputeStats recompute();
+
+    RecomputeStats recompute(ThreadPool &pool);
+
+    [[nodiscard]] std::size_t size() const;
+
+    // Why `name` evaluated to nil in the last recompute, if it failed
+    [[nodiscard]] std::optional<std::string> error(const std::string &name) const;
+
+    // Formula names by topological level
+    [[nodiscard]] std::vector<std::vector<std::string> > levels();
+
+private:
+    struct Formula {
+        std::string name;
+        std::size_t slot;
+        CompiledExpr expr;
+        std::vector<std::size_t> inputs; // distinct slots the formula reads
+        std::vector<std::uint64_t> seen; // input stamps at the last evaluation
+        bool stale = true; // (re)defined since the last evaluation
+        std::string error;
+    };
+
+    // Formula index that `slot` belongs to, if any
+    [[nodiscard]] std::optional<std::size_t> formulaOf(std::size_t slot) const;
+
+    // Throws if `inputs` reach the formula in `slot` through other formulas
+    void checkCycle(std::size_t slot, const std::string &name, const std::vector<std::size_t> &inputs) const;
+
+    void sortLevels();
+
+    RecomputeStats run(ThreadPool *pool);
+
+    Interpreter &m_ip;
+    std::vector<Formula> m_formulas;
+    std::unordered_map<std::size_t, std::size_t> m_bySlot; // output slot -> formula index
+    std::vector<std::vector<std::size_t> > m_levels; // formula indices
+    bool m_levelsDirty = false;
+};
+
+#endif // FORMULA_GRAPH_H
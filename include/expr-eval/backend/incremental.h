@@ -0,0 +1,77 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "compiled_expr.h"
+#include "eval_context.h"
+#include "runtime.h"
+#include "../frontend/ast.h"
+
+struct IncrementalStats {
+    std::uint64_t evaluated = 0; // nodes computed
+    std::uint64_t reused = 0; // memoized subtree results returned as-is
+};
+
+// Tree walker that memoizes the result of every AST node and, on the
+// next evaluation, recomputes only the paths from changed variables to
+// the root. Changes are found through EvalContext::versions(); each
+// variable knows the identifier nodes that read it, and each node its
+// parent, so a change invalidates exactly the subtrees that depend on
+// it. Results, errors and EvalCounters behave like Program::eval, except
+// that reused subtrees do not count again.
+//
+// Holds mutable memo state: use one IncrementalExpr per thread.
+class IncrementalExpr {
+public:
+    explicit IncrementalExpr(CompiledExpr expr);
+
+    RuntimeVar eval(const EvalContext &ctx);
+
+    // Forget every memoized result
+    void invalidate();
+
+    [[nodiscard]] const IncrementalStats &stats() const;
+
+    [[nodiscard]] const CompiledExpr &expr() const;
+
+private:
+    static constexpr std::size_t kNoParent = static_cast<std::size_t>(-1);
+
+    struct Entry {
+        const Node *node;
+        std::size_t parent;
+        std::size_t children[3]; // left/right or cond/then/else
+        std::vector<std::size_t> body; // Program statements
+        RuntimeVar memo;
+        bool valid = false;
+    };
+
+    std::size_t add(const Node &node, std::size_t parent);
+
+    // Mark `index` and its ancestors stale, stopping at one that already
+    // is: a stale node's value is not part of any valid ancestor
+    void invalidateUp(std::size_t index);
+
+    RuntimeVar evalNode(std::size_t index, std::span<const RuntimeVar> slots);
+
+    RuntimeVar compute(const Entry &entry, std::span<const RuntimeVar> slots);
+
+    CompiledExpr m_expr;
+    std::vector<Entry> m_entries; // m_entries[0] is the Program
+
+    // Per referenced variable: its slot, the stamp last seen, and the
+    // identifier nodes that read it
+    struct Var {
+        std::size_t slot;
+        std::uint64_t seen = 0;
+        std::vector<std::size_t> readers;
+    };
+    std::vector<Var> m_vars;
+
+    IncrementalStats m_stats;
+};
+
+#endif // INCREMENTAL_H
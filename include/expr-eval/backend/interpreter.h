@@ -1,25 +1,86 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 #include "runtime.h"
+#include "compiled_expr.h"
+#include "expr_cache.h"
+#include "incremental.h"
+#include "eval_context.h"
 #include "../frontend/parser.h"
+#include "../frontend/symbols.h"
 
 class Interpreter {
 public:
     Interpreter();
 
+    // Recently evaluated sources are kept compiled in an LRU cache, so
+    // repeating the same text skips the lexer and parser
     RuntimeVar eval(const std::string& input);
 
+    // Parse and optimize `input` once; the result can be evaluated
+    // repeatedly and runs on the engine that was selected when it was
+    // compiled
+    CompiledExpr compile(const std::string& input, const OptimizerOptions& options = {});
+
+    // Compile against declared variable types, e.g. from
+    // Schema::parse("x: number, f_name: string", symbols()). Type errors
+    // are thrown here rather than at evaluation, and the expression runs
+    // as typed bytecode without per-operator type checks, whatever the
+    // selected engine.
+    CompiledExpr compile(const std::string& input, const Schema& schema, const OptimizerOptions& options = {});
+
+    RuntimeVar eval(const CompiledExpr& expr);
+
+    // Recompute only what changed since `expr` was last evaluated here
+    RuntimeVar eval(IncrementalExpr& expr);
+
+    // Snapshot of the current variable values for evaluating compiled
+    // expressions on another thread
+    [[nodiscard]] EvalContext makeContext() const;
+
     void addVar(const std::string& ident, RuntimeVar val);
 
     RuntimeVar getVar(const std::string& ident);
 
+    // Slot-based access for hosts updating variables in a hot loop;
+    // slots are stable once a variable has been added.
+    std::size_t slotOf(const std::string& ident) const;
+
+    void setVar(std::size_t slot, RuntimeVar val);
+
+    const RuntimeVar& getVar(std::size_t slot) const;
+
+    [[nodiscard]] const SymbolTable& symbols() const;
+
+    // Current variable values, indexed by slot
+    [[nodiscard]] std::span<const RuntimeVar> values() const;
+
+    // Write stamps of values(), see EvalContext::versions()
+    [[nodiscard]] std::span<const std::uint64_t> versions() const;
+
+    void setEngine(Engine engine);
+
+    [[nodiscard]] Engine engine() const;
+
+    // Zero disables caching in eval(const std::string&)
+    void setCacheCapacity(std::size_t capacity);
+
+    [[nodiscard]] const ExprCache& cache() const;
+
+    void clearCache();
+
 private:
     Parser parser;
-    std::unordered_map<std::string, RuntimeVar> m_vars;
+    Engine m_engine = Engine::TREE_WALKER;
+    ExprCache m_cache;
+    SymbolTable m_symbols;
+    EvalContext m_context; // values indexed by m_symbols slot
 };
 
 #endif // INTERPRETER_H
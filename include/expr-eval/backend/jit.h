@@ -0,0 +1,68 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "runtime.h"
+#include "../frontend/ast.h"
+
+// Native x86-64 SSE2 code for a numeric expression, living in its own
+// executable mapping. The generated function reads its operands straight
+// out of the slot array, so evaluation neither allocates nor copies.
+class JitCode {
+public:
+    JitCode(const JitCode &) = delete;
+
+    JitCode &operator=(const JitCode &) = delete;
+
+    ~JitCode();
+
+    // Run the native code, or return nullopt if a referenced slot is
+    // missing or does not hold a number; the caller then falls back to
+    // the interpreter, which also raises the proper type error.
+    [[nodiscard]] std::optional<RuntimeVar> eval(std::span<const RuntimeVar> slots) const;
+
+    // Size of the generated machine code in bytes
+    [[nodiscard]] std::size_t codeSize() const;
+
+private:
+    friend class JitCompiler;
+
+    using Fn = double (*)(const RuntimeVar *slots);
+
+    JitCode(void *page, std::size_t pageSize, std::size_t codeSize,
+            std::vector<std::size_t> slots, bool resultIsBool);
+
+    void *m_page;
+    std::size_t m_pageSize;
+    std::size_t m_codeSize;
+    Fn m_fn;
+    std::vector<std::size_t> m_slots; // slots that must hold numbers
+    bool m_resultIsBool;
+};
+
+// Lowers a Program of number literals, identifiers and arithmetic,
+// relational and logical BinaryExprs and conditionals to native code.
+// Native code is branch-free, so it does not update EvalCounters.
+class JitCompiler {
+public:
+    // True when this build can generate native code at all
+    static constexpr bool kSupported =
+#if defined(__x86_64__) && !defined(_WIN32)
+            true;
+#else
+            false;
+#endif
+
+    // nullptr when the expression uses anything the JIT does not handle
+    // (strings, nil, `%`, multiple expressions, too deep a tree) or when
+    // the platform is unsupported
+    static std::shared_ptr<const JitCode> compile(const Program &program);
+};
+
+#endif // JIT_H
@@ -0,0 +1,49 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file. On POSIX systems the file is mmap'd,
+// so its bytes are paged in on demand and never copied into the process
+// heap; elsewhere it is read into an owned buffer.
+class MappedFile {
+public:
+    // Throws std::runtime_error if the file cannot be opened or mapped,
+    // including when it is not a regular file
+    explicit MappedFile(const std::string &path);
+
+    // True if `path` is a regular file. Pipes, FIFOs and devices such as
+    // `<(cmd)` or /dev/stdin have no size to map and must be streamed.
+    static bool mappable(const std::string &path);
+
+    MappedFile(MappedFile &&other) noexcept;
+
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    // Valid for the lifetime of this object
+    [[nodiscard]] std::string_view view() const;
+
+    [[nodiscard]] std::size_t size() const;
+
+    // Hint that bytes in [begin, end) will not be read again, so their
+    // pages can leave resident memory. The view stays valid; evicted
+    // pages are read back in if touched.
+    void evict(std::size_t begin, std::size_t end) const;
+
+private:
+    void release();
+
+    const char *m_data = nullptr;
+    std::size_t m_size = 0;
+    std::string m_owned; // backing store when mmap is unavailable
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,50 @@
+#ifndef OPS_H
+#define OPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "runtime.h"
+
+// ----- BINARY OPERATORS ----- //
+enum class BinaryOp : std::uint8_t {
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+
+    OR, // ||
+    AND, // &&
+
+    EQ, // ==
+    NEQ, // !=
+    LT, // <
+    LT_EQ, // <=
+    GT, // >
+    GT_EQ, // >=
+};
+
+constexpr std::size_t kBinaryOpCount = static_cast<std::size_t>(BinaryOp::GT_EQ) + 1;
+constexpr std::size_t kRuntimeVarTypeCount = 4;
+
+std::string_view binaryOpStr(BinaryOp op);
+
+// ----- DISPATCH TABLE ----- //
+using BinaryFn = RuntimeVar (*)(const RuntimeVar &, const RuntimeVar &);
+
+// Kernels for one operator, indexed by [left type][right type]. Cells for
+// supported type pairs (number+number, string+string, ...) compute the
+// result directly; every other cell reports the type error.
+struct BinaryKernels {
+    BinaryFn fn[kRuntimeVarTypeCount][kRuntimeVarTypeCount];
+
+    RuntimeVar operator()(const RuntimeVar &l, const RuntimeVar &r) const {
+        return fn[static_cast<std::size_t>(l.type)][static_cast<std::size_t>(r.type)](l, r);
+    }
+};
+
+const BinaryKernels &binaryKernels(BinaryOp op);
+
+#endif // OPS_H
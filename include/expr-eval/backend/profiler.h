@@ -0,0 +1,68 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "ops.h"
+#include "runtime.h"
+#include "../frontend/ast.h"
+#include "../picojson.h"
+
+// What one AST node did across all profiled evaluations
+struct NodeProfile {
+    std::uint64_t evals = 0;
+    std::uint64_t totalNs = 0; // including the node's children
+    std::uint64_t selfNs = 0; // excluding them
+    std::uint64_t results[kRuntimeVarTypeCount] = {}; // indexed by RuntimeVarType
+    std::uint64_t errors = 0; // evaluations that threw
+};
+
+// Opt-in per-node profiling of the tree walker. Evaluating a Program
+// through a Profiler gives the same results and EvalCounters as
+// Program::eval while recording a NodeProfile for every node; Program::eval
+// itself is untouched, so code that does not profile pays nothing.
+// Timings include the cost of reading the clock around each node.
+class Profiler {
+public:
+    // `program` must outlive the profiler and stay unchanged
+    explicit Profiler(const Program &program);
+
+    RuntimeVar eval(std::span<const RuntimeVar> slots);
+
+    // Zero every node's counters
+    void reset();
+
+    // Throws std::out_of_range if `node` is not part of the program
+    [[nodiscard]] const NodeProfile &profile(const Node &node) const;
+
+    // Program::dump() with a "profile" object added to every node:
+    // {"evals", "total_ns", "self_ns", "avg_ns", "results": {"number": ...}, "errors"}
+    [[nodiscard]] picojson::value dump() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        const Node *node;
+        std::size_t children[3]; // in dump() order, e.g. left/right or cond/then/else
+        std::size_t childCount = 0;
+        std::vector<std::size_t> body; // Program statements
+        NodeProfile stats;
+    };
+
+    std::size_t add(const Node &node);
+
+    RuntimeVar evalNode(std::size_t index, std::span<const RuntimeVar> slots, std::uint64_t &parentNs);
+
+    RuntimeVar apply(const Entry &entry, std::span<const RuntimeVar> slots, std::uint64_t &childNs);
+
+    void annotate(std::size_t index, picojson::value &dump) const;
+
+    std::vector<Entry> m_entries; // m_entries[0] is the Program
+};
+
+#endif // PROFILER_H
@@ -1,9 +1,66 @@
 #ifndef RUNTIME_H
 #define RUNTIME_H
 
+#include <atomic>
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <format>
 
+// Heap payload of a string RuntimeVar, shared by reference between
+// copies and released when the last copy goes away.
+//
+// A value is either flat text or a rope node joining two other values.
+// Concatenating long strings only links them, so a chain like
+// `a + " " + b + ...` costs O(1) per `+`; the text is built once, with a
+// single allocation, the first time it is read.
+struct StringValue {
+    // Concatenations shorter than this are copied eagerly; a rope node
+    // would cost more than the bytes it saves
+    static constexpr std::size_t kRopeThreshold = 256;
+
+    std::atomic<std::size_t> refs{1};
+
+    explicit StringValue(std::string s);
+
+    StringValue(const StringValue &) = delete;
+
+    StringValue &operator=(const StringValue &) = delete;
+
+    // New value (refs == 1) holding `left` followed by `right`
+    static StringValue *concat(StringValue *left, StringValue *right);
+
+    // Drop one reference, freeing the value and any rope children that
+    // become unreferenced without recursing
+    static void release(StringValue *value);
+
+    [[nodiscard]] std::size_t size() const;
+
+    // Flat text; a rope is flattened on first use. Safe to call from
+    // several threads on a shared value.
+    [[nodiscard]] const std::string &str() const;
+
+    [[nodiscard]] bool isRope() const;
+
+    // Append to flat text in place; the caller must hold the only reference
+    void append(std::string_view text);
+
+private:
+    StringValue(StringValue *left, StringValue *right);
+
+    ~StringValue() = default;
+
+    void flatten() const;
+
+    std::size_t m_size;
+    mutable std::atomic<bool> m_flat;
+    mutable StringValue *m_left = nullptr, *m_right = nullptr; // rope children until flattened
+    mutable std::string m_str;
+};
+
+// Tagged union over the runtime types. Numbers, bools and nil live
+// inline, so copying them never allocates; strings point to a shared
+// StringValue. Text is only produced on demand by toString().
 struct RuntimeVar {
     enum class RuntimeVarType{
         STRING,
@@ -12,9 +69,11 @@ struct RuntimeVar {
         BOOL
     } type;
 
-    std::string value;
-    bool b_value = false;
-    double d_value = 0.0;
+    union {
+        double d_value;
+        bool b_value;
+        StringValue *s_value;
+    };
 
     RuntimeVar();
 
@@ -24,6 +83,16 @@ struct RuntimeVar {
 
     explicit RuntimeVar(double d);
 
+    RuntimeVar(const RuntimeVar& other);
+
+    RuntimeVar(RuntimeVar&& other) noexcept;
+
+    RuntimeVar& operator=(const RuntimeVar& other);
+
+    RuntimeVar& operator=(RuntimeVar&& other) noexcept;
+
+    ~RuntimeVar();
+
     [[nodiscard]] std::string typeStr() const;
 
     [[nodiscard]] double toDouble() const;
@@ -32,8 +101,18 @@ struct RuntimeVar {
 
     [[nodiscard]] bool toBool() const;
 
+    // Borrow the text of a STRING value without copying it
+    [[nodiscard]] const std::string& str() const;
+
     RuntimeVar operator+(const RuntimeVar& other) const;
 
+    // String `+` without type checks; both operands must be strings
+    static RuntimeVar concat(const RuntimeVar& l, const RuntimeVar& r);
+
+    // `l = l + r` for strings; a temporary `l` that nothing else shares
+    // grows in place instead of being copied into a new value
+    static void append(RuntimeVar& l, const RuntimeVar& r);
+
     RuntimeVar operator-(const RuntimeVar& other) const;
 
     RuntimeVar operator*(const RuntimeVar& other) const;
@@ -57,6 +136,19 @@ struct RuntimeVar {
     RuntimeVar operator||(const RuntimeVar& other) const;
 
     RuntimeVar operator&&(const RuntimeVar& other) const;
+
+private:
+    // Adopt a StringValue reference
+    explicit RuntimeVar(StringValue* s);
+
+    void checkSameType(const char* op, const RuntimeVar& other) const;
+
+    // Copy the tag and active member without touching reference counts
+    void assign(const RuntimeVar& other);
+
+    void retain() const;
+
+    void release() const;
 };
 
 #endif // RUNTIME_H
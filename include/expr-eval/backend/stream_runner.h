@@ -0,0 +1,74 @@
+#ifndef STREAM_RUNNER_H
+#define STREAM_RUNNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <string_view>
+
+#include "compiled_expr.h"
+#include "eval_context.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "../frontend/symbols.h"
+
+struct StreamOptions {
+    // Engine::JIT is treated as TREE_WALKER: every line is evaluated
+    // once, so generating native code would never pay off
+    Engine engine = Engine::TREE_WALKER;
+
+    std::size_t batchLines = 256; // lines handed between stages at once
+    std::size_t queueDepth = 64; // batches buffered between two stages
+    std::size_t outputBuffer = 1 << 20; // bytes collected before each write
+    std::size_t chunkBytes = 1 << 20; // input per task when running over a buffer
+};
+
+struct StreamStats {
+    std::size_t lines = 0; // input lines, including blank ones
+    std::size_t expressions = 0; // non-blank lines evaluated
+    std::size_t errors = 0; // lines that failed to parse or evaluate
+    std::uint64_t bytesIn = 0;
+    std::uint64_t bytesOut = 0;
+    double seconds = 0.0; // wall time of the whole run
+    double parseSeconds = 0.0; // time spent parsing, summed over threads
+    double evalSeconds = 0.0; // time spent evaluating, summed over threads
+
+    // One human-readable summary line, e.g. for stderr
+    void print(std::FILE *out) const;
+};
+
+// Non-interactive evaluation of one expression per input line. Reading,
+// parsing and evaluation run as pipelined stages on separate threads,
+// joined by bounded queues. Results are written in input order as
+// NDJSON, one object per non-blank line:
+//
+//   {"line":1,"value":14}
+//   {"line":2,"error":"Use of undefined variable `y`"}
+class StreamRunner {
+public:
+    // Identifiers resolve against `symbols`, which must not change during
+    // run(); values are read from `context`
+    StreamRunner(const SymbolTable &symbols, EvalContext context, StreamOptions options = {});
+
+    StreamStats run(std::istream &in, std::FILE *out);
+
+    // Same output for input that is already in memory, such as a
+    // MappedFile. Lines are lexed in place, without copying them into
+    // strings; the input is cut into newline-aligned chunks that are
+    // parsed and evaluated on `pool`, and their output is written in order.
+    StreamStats run(std::string_view input, std::FILE *out, ThreadPool &pool);
+
+    // As above, evicting the pages of the file that have been processed
+    // so resident memory stays flat on inputs larger than RAM
+    StreamStats run(const MappedFile &input, std::FILE *out, ThreadPool &pool);
+
+private:
+    StreamStats runChunks(std::string_view input, std::FILE *out, ThreadPool &pool, const MappedFile *file);
+
+    const SymbolTable &m_symbols;
+    EvalContext m_context;
+    StreamOptions m_options;
+};
+
+#endif // STREAM_RUNNER_H
@@ -0,0 +1,62 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool with one task deque per worker. A worker takes work
+// from the back of its own deque and, when that runs dry, steals from
+// the front of the others, so uneven tasks even out across threads.
+class ThreadPool {
+public:
+    // Each task receives the index of the worker running it, which
+    // callers use to pick per-worker state without locking.
+    using Task = std::function<void(std::size_t worker)>;
+
+    explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency());
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool();
+
+    [[nodiscard]] std::size_t size() const;
+
+    void submit(Task task);
+
+    // Run fn(i, worker) for every i in [0, count) and wait for all of
+    // them. The first exception thrown by a call is rethrown here. Must
+    // not be called from inside a task of the same pool.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t i, std::size_t worker)> &fn);
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(std::size_t id);
+
+    bool pop(std::size_t id, Task &task);
+
+    bool steal(std::size_t id, Task &task);
+
+    std::vector<std::unique_ptr<Worker> > m_workers;
+    std::vector<std::thread> m_threads;
+    std::atomic<std::size_t> m_next{0}; // round-robin target for submit()
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<std::size_t> m_queued{0};
+    bool m_stop = false;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,87 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "../picojson.h"
+
+// Opt-in tracing of the phases of evaluation (tokenize, parse, optimize,
+// compile, eval) in Chrome trace-event format, for chrome://tracing or
+// Perfetto. Each thread records completed spans into its own fixed-size
+// ring buffer without locking; when a ring is full the oldest spans are
+// overwritten. A finished thread's ring is kept until write() has
+// exported it or clear() has discarded it. While tracing is disabled a
+// TRACE_SCOPE costs one relaxed load and a predictable branch.
+class Tracer {
+public:
+    static constexpr std::size_t kBufferCapacity = 1 << 16; // spans kept per thread
+
+    static void enable();
+
+    static void disable();
+
+    static bool enabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    // dump(), write() and clear() read every thread's ring without
+    // synchronizing with the writers: call them once tracing is disabled
+    // and traced work has finished.
+
+    // {"traceEvents": [...], "displayTimeUnit": "ns", "otherData": {...}}
+    [[nodiscard]] static picojson::value dump();
+
+    // Throws std::runtime_error if `path` cannot be written. Frees the
+    // rings of threads that have exited, whose spans are now on disk.
+    static void write(const std::string &path);
+
+    // Discard every recorded span, and the rings of exited threads
+    static void clear();
+
+    // Nanoseconds on the trace clock
+    static std::uint64_t now();
+
+    // Append a completed span to the calling thread's ring; `name` must
+    // have static storage duration
+    static void record(const char *name, std::uint64_t startNs, std::uint64_t endNs);
+
+private:
+    static inline std::atomic<bool> s_enabled{false};
+};
+
+// Records a span from construction to destruction if tracing was enabled
+// when it began
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) {
+        if (Tracer::enabled()) [[unlikely]] {
+            m_name = name;
+            m_start = Tracer::now();
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    ~TraceScope() {
+        if (m_name != nullptr) [[unlikely]]
+            Tracer::record(m_name, m_start, Tracer::now());
+    }
+
+private:
+    const char *m_name = nullptr;
+    std::uint64_t m_start = 0;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Trace the rest of the enclosing block as a span called `name`, which
+// must be a string literal
+#define TRACE_SCOPE(name) const TraceScope TRACE_CONCAT(traceScope, __LINE__){name}
+
+#endif // TRACE_H
@@ -0,0 +1,24 @@
+#ifndef VM_H
+#define VM_H
+
+#include <span>
+#include <vector>
+
+#include "runtime.h"
+#include "bytecode.h"
+
+// Stack machine executing a Chunk or ChunkView. The operand stack is kept between
+// runs so steady-state evaluation does not allocate for it.
+class VM {
+public:
+    VM() = default;
+
+    RuntimeVar run(const Chunk &chunk, std::span<const RuntimeVar> slots);
+
+    RuntimeVar run(const ChunkView &chunk, std::span<const RuntimeVar> slots);
+
+private:
+    std::vector<RuntimeVar> m_stack;
+};
+
+#endif // VM_H
@@ -0,0 +1,82 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator owning every node of a parse. Memory is handed out from
+// large blocks and reclaimed all at once by reset(), which keeps the
+// blocks for the next parse. Objects with a non-trivial destructor are
+// remembered and destroyed on reset; for trivially destructible nodes
+// reset is just a cursor rewind.
+class Arena {
+public:
+    explicit Arena(std::size_t blockSize = 4096);
+
+    Arena(const Arena &) = delete;
+
+    Arena &operator=(const Arena &) = delete;
+
+    ~Arena();
+
+    void *allocate(std::size_t size, std::size_t align);
+
+    template<typename T, typename... Args>
+    T *make(Args &&... args) {
+        T *obj = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        ++m_allocations;
+
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            addFinalizer(obj, [](void *p) { static_cast<T *>(p)->~T(); });
+        }
+
+        return obj;
+    }
+
+    // Copy `str` into the arena so it lives as long as the nodes do
+    std::string_view copy(std::string_view str);
+
+    // Destroy everything allocated so far, keeping the blocks
+    void reset();
+
+    // Objects created by make() since the last reset
+    [[nodiscard]] std::size_t allocations() const;
+
+    // Blocks requested from the system allocator over the arena's lifetime
+    [[nodiscard]] std::size_t blockAllocations() const;
+
+    [[nodiscard]] std::size_t bytesUsed() const;
+
+    [[nodiscard]] std::size_t capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+    };
+
+    struct Finalizer {
+        void (*destroy)(void *);
+        void *obj;
+        Finalizer *next;
+    };
+
+    void addFinalizer(void *obj, void (*destroy)(void *));
+
+    void runFinalizers();
+
+    std::size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    std::size_t m_current = 0; // index of the block being filled
+    std::size_t m_offset = 0; // cursor within m_blocks[m_current]
+    std::size_t m_used = 0; // bytes in blocks before m_current
+    std::size_t m_allocations = 0;
+    Finalizer *m_finalizers = nullptr;
+};
+
+#endif // ARENA_H
@@ -1,13 +1,17 @@
 #ifndef AST_H
 #define AST_H
 
-#include <memory>
+#include <cstddef>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 
 #include "../backend/runtime.h"
+#include "../backend/ops.h"
+#include "../backend/eval_counters.h"
 #include "../picojson.h"
+#include "arena.h"
 
 
 // ----- NODE TYPE ----- //
@@ -23,114 +27,181 @@ enum class NodeType {
 
     // Composites
     BINARY_EXPR,
+    CONDITIONAL_EXPR,
 
     // EOF
     END_OF_FILE
 };
 
 // ----- NODE ----- //
+// Nodes live in the owning Program's Arena and are never deleted one by
+// one, so they keep a trivial destructor wherever possible.
 struct Node {
-    std::string name;
+    std::string_view name;
     NodeType type;
 
-    Node(NodeType t, std::string name);
+    Node(NodeType t, std::string_view name);
 
-    virtual ~Node();
+    virtual picojson::value dump() const;
 
-    virtual picojson::value dump();
+    virtual RuntimeVar eval(std::span<const RuntimeVar> slots) const;
 
-    virtual RuntimeVar eval(std::unordered_map<std::string, RuntimeVar> &vars);
+protected:
+    ~Node() = default;
 };
 
 
 // ----- PROGRAM NODE ----- //
+// Owns the arena every node of the parse is allocated from.
 struct Program : Node {
     Program();
 
-    void addNode(std::unique_ptr<Node> node);
+    void addNode(Node *node);
 
+    // Drop all nodes; the arena keeps its blocks for the next parse
     void clear();
 
-    picojson::value dump() override;
+    [[nodiscard]] const std::vector<Node *> &getNodes() const;
 
-    RuntimeVar eval(std::unordered_map<std::string, RuntimeVar> &vars) override;
+    // One past the highest variable slot the program reads; eval()
+    // throws if given fewer values than that
+    [[nodiscard]] std::size_t slotCount() const;
+
+    Arena &arena();
+
+    [[nodiscard]] const Arena &arena() const;
+
+    picojson::value dump() const override;
+
+    RuntimeVar eval(std::span<const RuntimeVar> slots) const override;
 
 private:
-    std::vector<std::unique_ptr<Node> > m_ast;
+    friend class Optimizer;
+
+    Arena m_arena;
+    std::vector<Node *> m_ast;
+    std::size_t m_slotCount = 0;
 };
 
 
 // ----- EXPR NODE ----- //
 struct Expr : Node {
-    Expr(NodeType t, const std::string &name);
+    Expr(NodeType t, std::string_view name);
 };
 
 
 // ----- BINARY EXPR NODE ----- //
+// The operator is fixed at parse time, so evaluation is a single lookup
+// into that operator's per-type kernel table. `&&` and `||` short-circuit
+// and only evaluate `right` when `left` does not decide the result.
 struct BinaryExpr : Expr {
-    BinaryExpr(std::unique_ptr<Node> left, std::string op, std::unique_ptr<Node> right);
+    BinaryExpr(Node *left, BinaryOp op, Node *right);
+
+    [[nodiscard]] const Node &getLeft() const;
+
+    [[nodiscard]] const Node &getRight() const;
+
+    [[nodiscard]] BinaryOp getOp() const;
 
-    picojson::value dump() override;
+    picojson::value dump() const override;
 
-    RuntimeVar eval(std::unordered_map<std::string, RuntimeVar> &vars) override;
+    RuntimeVar eval(std::span<const RuntimeVar> slots) const override;
 
 private:
-    std::unique_ptr<Node> left, right;
-    std::string op;
+    friend class Optimizer;
+
+    Node *left, *right;
+    BinaryOp op;
+    const BinaryKernels *kernels;
+};
+
+
+// ----- CONDITIONAL EXPR NODE ----- //
+// `cond ? then : otherwise`; only the selected branch is evaluated.
+struct ConditionalExpr : Expr {
+    ConditionalExpr(Node *cond, Node *then, Node *otherwise);
+
+    [[nodiscard]] const Node &getCondition() const;
+
+    [[nodiscard]] const Node &getThen() const;
+
+    [[nodiscard]] const Node &getElse() const;
+
+    picojson::value dump() const override;
+
+    RuntimeVar eval(std::span<const RuntimeVar> slots) const override;
+
+private:
+    friend class Optimizer;
+
+    Node *cond, *then, *otherwise;
 };
 
 
 // ----- NUMBER LITERAL NODE ----- //
 struct NumberLiteral : Expr {
-    explicit NumberLiteral(const std::string &value);
+    explicit NumberLiteral(double d);
+
+    [[nodiscard]] double getValue() const;
 
-    picojson::value dump() override;
+    picojson::value dump() const override;
 
-    RuntimeVar eval(std::unordered_map<std::string, RuntimeVar> &vars) override;
+    RuntimeVar eval(std::span<const RuntimeVar> slots) const override;
 
 private:
-    std::string value;
     double d;
 };
 
 
 // ----- BOOLEAN LITERAL NODE ----- //
 struct BooleanLiteral : Expr {
-    explicit BooleanLiteral(const std::string &value);
+    explicit BooleanLiteral(bool value);
+
+    [[nodiscard]] bool getValue() const;
 
-    picojson::value dump() override;
+    picojson::value dump() const override;
 
-    RuntimeVar eval(std::unordered_map<std::string, RuntimeVar> &vars) override;
+    RuntimeVar eval(std::span<const RuntimeVar> slots) const override;
 
 private:
-    std::string value;
     bool b_value;
 };
 
 
 // ----- STRING LITERAL NODE ----- //
+// Holds its value ready-made, so evaluation only shares the string.
 struct StringLiteral : Expr {
-    explicit StringLiteral(std::string value);
+    explicit StringLiteral(std::string_view value);
 
-    picojson::value dump() override;
+    [[nodiscard]] const std::string &getValue() const;
 
-    RuntimeVar eval(std::unordered_map<std::string, RuntimeVar> &vars) override;
+    picojson::value dump() const override;
+
+    RuntimeVar eval(std::span<const RuntimeVar> slots) const override;
 
 private:
-    std::string value;
+    RuntimeVar value;
 };
 
 
 // ----- IDENTIFIER LITERAL NODE ----- //
+// Identifiers are resolved to a SymbolTable slot at parse time and read
+// straight from the slot array on evaluation.
 struct IdentifierLiteral : Expr {
-    explicit IdentifierLiteral(std::string value);
+    // `value` must outlive the node, e.g. a string copied into the arena
+    IdentifierLiteral(std::string_view value, std::size_t slot);
+
+    [[nodiscard]] std::string_view getValue() const;
 
-    picojson::value dump() override;
+    [[nodiscard]] std::size_t getSlot() const;
 
-    RuntimeVar eval(std::unordered_map<std::string, RuntimeVar> &vars) override;
+    picojson::value dump() const override;
+
+    RuntimeVar eval(std::span<const RuntimeVar> slots) const override;
 
 private:
-    std::string value;
+    std::string_view value;
+    std::size_t slot;
 };
 
 
@@ -138,13 +209,73 @@ private:
 struct NullLiteral : Expr {
     NullLiteral();
 
-    picojson::value dump() override;
-
-    RuntimeVar eval(std::unordered_map<std::string, RuntimeVar> &vars) override;
+    picojson::value dump() const override;
 
-private:
-    std::string value = "nil";
+    RuntimeVar eval(std::span<const RuntimeVar> slots) const override;
 };
 
 
+// ----- SHARED EVALUATION ----- //
+// Which children an operator evaluates, and how it combines them. The
+// nodes' own eval() and every other evaluator of the tree (Profiler,
+// IncrementalExpr, ExprDag) go through these, so the lazy semantics of
+// `&&`, `||` and `?:` live in one place. `child(i)` evaluates child `i`:
+// left/right of a binary operator or cond/then/else of a conditional.
+template<typename Child>
+RuntimeVar evalBinary(const BinaryOp op, const BinaryKernels &kernels, Child &&child) {
+    if (op == BinaryOp::AND || op == BinaryOp::OR) {
+        auto &counters = evalCounters();
+        ++counters.branches;
+
+        // `false && _` and `true || _` are decided by the left side alone
+        const bool l = child(0).toBool();
+        if (l == (op == BinaryOp::OR)) {
+            ++counters.skipped;
+            return RuntimeVar{l};
+        }
+
+        return RuntimeVar{child(1).toBool()};
+    }
+
+    auto l = child(0);
+    const auto r = child(1);
+
+    // A string chain's running result is a temporary, so it can grow in
+    // place instead of being copied or linked at every `+`
+    if (op == BinaryOp::ADD && l.type == RuntimeVar::RuntimeVarType::STRING
+        && r.type == RuntimeVar::RuntimeVarType::STRING) {
+        RuntimeVar::append(l, r);
+        return l;
+    }
+
+    return kernels(l, r);
+}
+
+// Only the selected branch is evaluated
+template<typename Child>
+RuntimeVar evalConditional(Child &&child) {
+    auto &counters = evalCounters();
+    ++counters.branches;
+    ++counters.skipped;
+
+    return child(0).toBool() ? child(1) : child(2);
+}
+
+// Evaluate `node`, with `child` evaluating the children of a composite
+// node; leaves are evaluated directly. Programs are not handled here.
+template<typename Child>
+RuntimeVar evalNodeWith(const Node &node, const std::span<const RuntimeVar> slots, Child &&child) {
+    switch (node.type) {
+        case NodeType::BINARY_EXPR: {
+            const auto op = static_cast<const BinaryExpr &>(node).getOp();
+            return evalBinary(op, binaryKernels(op), child);
+        }
+        case NodeType::CONDITIONAL_EXPR:
+            return evalConditional(child);
+        default:
+            return node.eval(slots);
+    }
+}
+
+
 #endif // AST_H
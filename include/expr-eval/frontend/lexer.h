@@ -1,10 +1,13 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <cstdint>
 #include <string>
-#include <utility>
+#include <string_view>
 #include <vector>
 
+#include "../picojson.h"
+
 enum class TokenType {
     TOK_NUMBERS_LIT,
     TOK_STRING_LIT,
@@ -28,6 +31,9 @@ enum class TokenType {
     TOK_GT, // >
     TOK_GT_EQ, // >=
 
+    TOK_QUESTION, // ?
+    TOK_COLON, // :
+
 
     TOK_OPEN_PAREN, // (
     TOK_CLOSE_PAREN, // )
@@ -35,23 +41,33 @@ enum class TokenType {
     TOK_EOF
 };
 
+// Name of a token type, e.g. "TOK_ADD_OP", for dumps and diagnostics
+const char *tokenName(TokenType type);
+
+// A token is a view into the source passed to Lexer::tokenize; its text
+// is only valid while that source is alive.
 struct Token {
     TokenType type;
-    std::string name, value;
-
-    Token(TokenType _type, std::string _name, std::string _value);
+    std::uint32_t offset;
+    std::uint32_t length;
 };
 
 class Lexer {
 public:
     Lexer() = default;
 
-    // Given user input, convert it to vector of token object
-    const std::vector<Token> &tokenize(const std::string &src);
+    // Given user input, convert it to vector of token object. The input
+    // is not copied and must outlive the tokens.
+    const std::vector<Token> &tokenize(std::string_view src);
 
     // Return the vector of token object
     const std::vector<Token> &tokens();
 
+    // Source text covered by `token`
+    [[nodiscard]] std::string_view text(const Token &token) const;
+
+    [[nodiscard]] picojson::value dump() const;
+
 private:
     void tokenizeNumbers();
 
@@ -71,9 +87,11 @@ private:
 
     void expect(char c, const std::string &error);
 
+    void emit(TokenType type, std::size_t start);
+
 
-    int m_cursor = 0;
-    std::string m_src;
+    std::size_t m_cursor = 0;
+    std::string_view m_src;
     std::vector<Token> m_tokens;
 };
 
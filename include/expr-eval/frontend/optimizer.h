@@ -0,0 +1,47 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <cstddef>
+
+#include "ast.h"
+
+struct OptimizerOptions {
+    // Replace operators whose operands are all literals with the result
+    bool foldConstants = true;
+
+    // Algebraic identities such as `x * 1`, `x + 0` and `true && e`.
+    // Operands whose type is not known until runtime (identifiers) are
+    // assumed to hold the type the operator expects, so an ill-typed
+    // expression like `name * 1` evaluates instead of raising, and
+    // `x + 0` keeps the sign of a negative zero.
+    bool simplify = false;
+};
+
+struct OptimizerStats {
+    std::size_t nodesBefore = 0;
+    std::size_t nodesAfter = 0;
+
+    [[nodiscard]] std::size_t nodesRemoved() const;
+};
+
+// Rewrites a Program in place. Folding never changes the result of an
+// expression: operators that would raise at runtime are left untouched.
+class Optimizer {
+public:
+    explicit Optimizer(OptimizerOptions options = {});
+
+    OptimizerStats run(Program &program) const;
+
+private:
+    // Replacement nodes are allocated from `arena`; the nodes they
+    // replace stay there until the Program is cleared.
+    Node *optimize(Node *node, Arena &arena) const;
+
+    Node *fold(BinaryExpr &bin, Arena &arena) const;
+
+    Node *simplify(BinaryExpr &bin, Arena &arena) const;
+
+    OptimizerOptions m_options;
+};
+
+#endif // OPTIMIZER_H
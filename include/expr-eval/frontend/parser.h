@@ -2,41 +2,53 @@
 #define PARSER_H
 
 #include <memory>
+#include <string_view>
 
 #include "../picojson.h"
 #include "lexer.h"
 #include "ast.h"
+#include "symbols.h"
 
 class Parser {
 public:
     Parser() = default;
 
-    void parse(const std::string &src);
+    // Identifiers are resolved against `symbols`; referencing a name
+    // that has no slot is a parse error.
+    void parse(std::string_view src, const SymbolTable &symbols);
+
+    // Parse `src` into a freshly allocated Program owned by the caller,
+    // leaving the parser's own root untouched.
+    std::unique_ptr<Program> compile(std::string_view src, const SymbolTable &symbols);
 
     picojson::value dump();
 
     Program &root();
 
 private:
-    std::unique_ptr<Node> parseExpr();
+    void parseInto(std::string_view src, const SymbolTable &symbols, Program &program);
+
+    Node *parseExpr();
+
+    Node *parseConditional(); // cond ? a : b
 
-    std::unique_ptr<Node> parseOr(); // ||
+    Node *parseOr(); // ||
 
-    std::unique_ptr<Node> parseAnd(); // &&
+    Node *parseAnd(); // &&
 
-    std::unique_ptr<Node> parseEquality(); // == !=
+    Node *parseEquality(); // == !=
 
-    std::unique_ptr<Node> parseRelational(); // < > <= >=
+    Node *parseRelational(); // < > <= >=
 
-    std::unique_ptr<Node> parseAdditives();
+    Node *parseAdditives();
 
-    std::unique_ptr<Node> parseFactors();
+    Node *parseFactors();
 
-    std::unique_ptr<Node> parsePrimary();
+    Node *parsePrimary();
 
-    Token peek();
+    const Token &peek();
 
-    Token advance();
+    const Token &advance();
 
     bool eof();
 
@@ -45,6 +57,8 @@ private:
 
     int m_cursor = 0;
     Lexer lexer;
+    const SymbolTable *m_symbols = nullptr;
+    Arena *m_arena = nullptr; // arena of the Program being built
 
     // Store root node for the AST, in our case the Program node
     Program m_program;
@@ -0,0 +1,41 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <cstddef>
+#include <optional>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Maps identifiers to dense slot indices. Slots are only ever appended,
+// so an index stays valid for the lifetime of the table.
+class SymbolTable {
+public:
+    SymbolTable() = default;
+
+    // Return the slot for `ident`, allocating the next free one if needed
+    std::size_t declare(const std::string &ident);
+
+    // Accepts any string-like key without building a std::string
+    [[nodiscard]] std::optional<std::size_t> lookup(std::string_view ident) const;
+
+    [[nodiscard]] const std::string &name(std::size_t slot) const;
+
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    struct Hash {
+        using is_transparent = void;
+
+        std::size_t operator()(const std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    std::unordered_map<std::string, std::size_t, Hash, std::equal_to<> > m_slots;
+    std::vector<std::string> m_names;
+};
+
+#endif // SYMBOLS_H
@@ -0,0 +1,83 @@
+#ifndef TYPE_CHECKER_H
+#define TYPE_CHECKER_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "symbols.h"
+#include "../backend/runtime.h"
+
+// Compile-time type of an expression. The first four match
+// RuntimeVar::RuntimeVarType; ANY is a `?:` whose branches differ.
+enum class StaticType : std::uint8_t {
+    STRING,
+    NUMBER,
+    NIL,
+    BOOL,
+    ANY
+};
+
+std::string_view staticTypeStr(StaticType type);
+
+// ----- SCHEMA ----- //
+// Declared variable types, by SymbolTable slot.
+class Schema {
+public:
+    Schema() = default;
+
+    void declare(std::size_t slot, RuntimeVar::RuntimeVarType type);
+
+    [[nodiscard]] std::optional<RuntimeVar::RuntimeVarType> typeOf(std::size_t slot) const;
+
+    // Parse declarations such as "x: number, f_name: string"; types are
+    // string, number, bool or nil. Throws on a syntax error or a name
+    // that is not in `symbols`.
+    static Schema parse(std::string_view text, const SymbolTable &symbols);
+
+private:
+    std::unordered_map<std::size_t, RuntimeVar::RuntimeVarType> m_types;
+};
+
+// ----- TYPE CHECKER ----- //
+// Infers the type of every node of a Program from the schema and the
+// operator rules of RuntimeVar, so that every error the operators would
+// raise for the declared types is reported before evaluation. Both
+// branches of `?:` and both sides of `&&`/`||` are checked, even where
+// the value would decide at runtime that one is never evaluated.
+class TypeChecker {
+public:
+    // `schema` must outlive the checker
+    explicit TypeChecker(const Schema &schema);
+
+    // Throws std::runtime_error on the first type error or on a
+    // variable without a declared type
+    StaticType check(const Program &program);
+
+    // Type of a node of the last checked Program
+    [[nodiscard]] StaticType typeOf(const Node &node) const;
+
+    // Distinct variables the last checked Program reads
+    struct Input {
+        std::size_t slot;
+        RuntimeVar::RuntimeVarType type;
+        std::string_view name; // lives in the Program's arena
+    };
+
+    [[nodiscard]] const std::vector<Input> &inputs() const;
+
+private:
+    StaticType infer(const Node &node);
+
+    StaticType inferBinary(const BinaryExpr &bin);
+
+    const Schema &m_schema;
+    std::unordered_map<const Node *, StaticType> m_types;
+    std::vector<Input> m_inputs;
+};
+
+#endif // TYPE_CHECKER_H
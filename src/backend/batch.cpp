@@ -0,0 +1,237 @@
+#include "../../include/expr-eval/backend/batch.h"
+#include "../../include/expr-eval/backend/thread_pool.h"
+#include "../../include/expr-eval/backend/eval_context.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <format>
+
+// ----- KERNELS ----- //
+// Each functor maps two doubles to a double so that every operator,
+// including comparisons, runs through the same vectorizable loops.
+struct Add { double operator()(const double a, const double b) const { return a + b; } };
+struct Sub { double operator()(const double a, const double b) const { return a - b; } };
+struct Mul { double operator()(const double a, const double b) const { return a * b; } };
+struct Div { double operator()(const double a, const double b) const { return a / b; } };
+struct Mod { double operator()(const double a, const double b) const { return std::fmod(a, b); } };
+struct Or { double operator()(const double a, const double b) const { return (a != 0.0) | (b != 0.0) ? 1.0 : 0.0; } };
+struct And { double operator()(const double a, const double b) const { return (a != 0.0) & (b != 0.0) ? 1.0 : 0.0; } };
+struct Eq { double operator()(const double a, const double b) const { return a == b ? 1.0 : 0.0; } };
+struct Neq { double operator()(const double a, const double b) const { return a != b ? 1.0 : 0.0; } };
+struct Lt { double operator()(const double a, const double b) const { return a < b ? 1.0 : 0.0; } };
+struct LtEq { double operator()(const double a, const double b) const { return a <= b ? 1.0 : 0.0; } };
+struct Gt { double operator()(const double a, const double b) const { return a > b ? 1.0 : 0.0; } };
+struct GtEq { double operator()(const double a, const double b) const { return a >= b ? 1.0 : 0.0; } };
+
+// A resolved operand for one block: either a column of rows or a scalar
+struct Arg {
+    const double *vec;
+    double scalar;
+};
+
+template<typename F>
+static void apply(const Arg a, const Arg b, double *out, const std::size_t n) {
+    const F f{};
+    if (a.vec && b.vec) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = f(a.vec[i], b.vec[i]);
+    } else if (a.vec) {
+        const double s = b.scalar;
+        for (std::size_t i = 0; i < n; ++i) out[i] = f(a.vec[i], s);
+    } else if (b.vec) {
+        const double s = a.scalar;
+        for (std::size_t i = 0; i < n; ++i) out[i] = f(s, b.vec[i]);
+    } else {
+        std::fill_n(out, n, f(a.scalar, b.scalar));
+    }
+}
+
+static void applyOp(const BinaryOp op, const Arg a, const Arg b, double *out, const std::size_t n) {
+    switch (op) {
+        case BinaryOp::ADD: apply<Add>(a, b, out, n); break;
+        case BinaryOp::SUB: apply<Sub>(a, b, out, n); break;
+        case BinaryOp::MUL: apply<Mul>(a, b, out, n); break;
+        case BinaryOp::DIV: apply<Div>(a, b, out, n); break;
+        case BinaryOp::MOD: apply<Mod>(a, b, out, n); break;
+        case BinaryOp::OR: apply<Or>(a, b, out, n); break;
+        case BinaryOp::AND: apply<And>(a, b, out, n); break;
+        case BinaryOp::EQ: apply<Eq>(a, b, out, n); break;
+        case BinaryOp::NEQ: apply<Neq>(a, b, out, n); break;
+        case BinaryOp::LT: apply<Lt>(a, b, out, n); break;
+        case BinaryOp::LT_EQ: apply<LtEq>(a, b, out, n); break;
+        case BinaryOp::GT: apply<Gt>(a, b, out, n); break;
+        case BinaryOp::GT_EQ: apply<GtEq>(a, b, out, n); break;
+    }
+}
+
+// ----- BATCH PROGRAM ----- //
+BatchProgram::BatchProgram(const Program &program) {
+    const auto &nodes = program.getNodes();
+    if (nodes.empty())
+        throw std::runtime_error("Batch evaluation needs a non-empty expression");
+
+    // Earlier expressions of a Program have no effect on its value
+    m_result = compileNode(*nodes.back(), 0, m_resultKind);
+}
+
+BatchProgram::Operand BatchProgram::compileNode(const Node &node, const std::uint32_t depth, Kind &kind) {
+    switch (node.type) {
+        case NodeType::NUMBER_LIT:
+            kind = Kind::NUMBER;
+            return Operand{Operand::Kind::CONST, 0, static_cast<const NumberLiteral &>(node).getValue()};
+        case NodeType::BOOLEAN_LIT:
+            kind = Kind::BOOL;
+            return Operand{Operand::Kind::CONST, 0, static_cast<const BooleanLiteral &>(node).getValue() ? 1.0 : 0.0};
+        case NodeType::IDENT_LIT:
+            kind = Kind::NUMBER;
+            return Operand{Operand::Kind::VAR, static_cast<std::uint32_t>(static_cast<const IdentifierLiteral &>(node).getSlot())};
+        case NodeType::BINARY_EXPR:
+            break;
+        default:
+            throw std::runtime_error(std::format("Batch evaluation does not support `{}`", node.name));
+    }
+
+    const auto &bin = static_cast<const BinaryExpr &>(node);
+    Kind lk, rk;
+    const auto lhs = compileNode(bin.getLeft(), depth, lk);
+    const auto rhs = compileNode(bin.getRight(), depth + 1, rk);
+
+    switch (bin.getOp()) {
+        case BinaryOp::ADD:
+        case BinaryOp::SUB:
+        case BinaryOp::MUL:
+        case BinaryOp::DIV:
+        case BinaryOp::MOD:
+        case BinaryOp::LT:
+        case BinaryOp::LT_EQ:
+        case BinaryOp::GT:
+        case BinaryOp::GT_EQ:
+            if (lk != Kind::NUMBER || rk != Kind::NUMBER)
+                throw std::runtime_error(std::format("Batch evaluation expects numbers for op '{}'",
+                                                     binaryOpStr(bin.getOp())));
+            break;
+        case BinaryOp::EQ:
+        case BinaryOp::NEQ:
+            if (lk != rk)
+                throw std::runtime_error(std::format("Batch evaluation expects same types for op '{}'",
+                                                     binaryOpStr(bin.getOp())));
+            break;
+        default: // && and || accept any operand
+            break;
+    }
+
+    switch (bin.getOp()) {
+        case BinaryOp::ADD:
+        case BinaryOp::SUB:
+        case BinaryOp::MUL:
+        case BinaryOp::DIV:
+        case BinaryOp::MOD:
+            kind = Kind::NUMBER;
+            break;
+        default:
+            kind = Kind::BOOL;
+            break;
+    }
+
+    m_steps.push_back(Step{bin.getOp(), lhs, rhs, depth});
+    m_scratch = std::max<std::size_t>(m_scratch, depth + 1);
+    return Operand{Operand::Kind::TEMP, depth};
+}
+
+void BatchProgram::eval(const std::span<const std::span<const double> > columns,
+                        const std::span<const RuntimeVar> scalars,
+                        const std::span<double> out) const {
+    checkColumns(columns, out.size());
+
+    std::vector<double> scratch;
+    evalRows(columns, scalars, out, 0, out.size(), scratch);
+}
+
+void BatchProgram::eval(const std::span<const std::span<const double> > columns,
+                        const std::span<double> out,
+                        EvalContext &ctx) const {
+    checkColumns(columns, out.size());
+    evalRows(columns, ctx.values(), out, 0, out.size(), ctx.batchScratch());
+}
+
+void BatchProgram::evalParallel(const std::span<const std::span<const double> > columns,
+                                const std::span<const RuntimeVar> scalars,
+                                const std::span<double> out,
+                                ThreadPool &pool,
+                                std::size_t morselRows) const {
+    checkColumns(columns, out.size());
+
+    // Keep morsels block-aligned so only the last one is partial
+    morselRows = std::max(kBlockRows, morselRows / kBlockRows * kBlockRows);
+    const auto rows = out.size();
+    const auto morsels = (rows + morselRows - 1) / morselRows;
+
+    std::vector<std::vector<double> > scratch(pool.size());
+    pool.parallelFor(morsels, [&](const std::size_t m, const std::size_t worker) {
+        const auto begin = m * morselRows;
+        evalRows(columns, scalars, out, begin, std::min(rows, begin + morselRows), scratch[worker]);
+    });
+}
+
+void BatchProgram::checkColumns(const std::span<const std::span<const double> > columns, const std::size_t rows) const {
+    for (std::size_t slot = 0; slot < columns.size(); ++slot) {
+        if (!columns[slot].empty() && columns[slot].size() < rows)
+            throw std::runtime_error(std::format("Column {} has {} rows, expected {}", slot, columns[slot].size(), rows));
+    }
+}
+
+void BatchProgram::evalRows(const std::span<const std::span<const double> > columns,
+                            const std::span<const RuntimeVar> scalars,
+                            const std::span<double> out,
+                            const std::size_t begin, const std::size_t end,
+                            std::vector<double> &scratch) const {
+    scratch.resize(m_scratch * kBlockRows);
+
+    auto resolve = [&](const Operand &operand, const std::size_t start) -> Arg {
+        switch (operand.kind) {
+            case Operand::Kind::CONST:
+                return Arg{nullptr, operand.value};
+            case Operand::Kind::TEMP:
+                return Arg{scratch.data() + operand.index * kBlockRows, 0.0};
+            default:
+                if (operand.index < columns.size() && !columns[operand.index].empty())
+                    return Arg{columns[operand.index].data() + start, 0.0};
+
+                if (operand.index >= scalars.size())
+                    throw std::runtime_error(std::format("No column or value for slot {}", operand.index));
+
+                return Arg{nullptr, scalars[operand.index].toDouble()};
+        }
+    };
+
+    for (std::size_t start = begin; start < end; start += kBlockRows) {
+        const auto n = std::min(kBlockRows, end - start);
+
+        if (m_steps.empty()) {
+            // A bare literal or variable
+            const auto arg = resolve(m_result, start);
+            if (arg.vec) std::copy_n(arg.vec, n, out.data() + start);
+            else std::fill_n(out.data() + start, n, arg.scalar);
+            continue;
+        }
+
+        for (std::size_t i = 0; i < m_steps.size(); ++i) {
+            const auto &step = m_steps[i];
+
+            // The root is always the last step; write it straight to `out`
+            double *dst = i + 1 == m_steps.size()
+                              ? out.data() + start
+                              : scratch.data() + step.dst * kBlockRows;
+
+            applyOp(step.op, resolve(step.lhs, start), resolve(step.rhs, start), dst, n);
+        }
+    }
+}
+
+bool BatchProgram::resultIsBool() const {
+    return m_resultKind == Kind::BOOL;
+}
+
+std::size_t BatchProgram::scratchColumns() const {
+    return m_scratch;
+}
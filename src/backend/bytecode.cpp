@@ -0,0 +1,147 @@
+#include "../../include/expr-eval/backend/bytecode.h"
+#include "../../include/expr-eval/backend/trace.h"
+
+#include <stdexcept>
+#include <format>
+
+Chunk BytecodeCompiler::compile(const Program &program, const TypeChecker *types) {
+    TRACE_SCOPE("BytecodeCompiler::compile");
+    BytecodeCompiler compiler;
+    compiler.m_types = types;
+
+    const auto &nodes = program.getNodes();
+    if (nodes.empty()) {
+        compiler.emit(OpCode::PUSH_NIL);
+    }
+
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        compiler.emitNode(*nodes[i]);
+
+        // Like Program::eval, only the last expression's value is kept
+        if (i + 1 < nodes.size())
+            compiler.emit(OpCode::POP);
+    }
+
+    compiler.emit(OpCode::RETURN);
+    return std::move(compiler.m_chunk);
+}
+
+void BytecodeCompiler::emitNode(const Node &node) {
+    switch (node.type) {
+        case NodeType::NUMBER_LIT:
+            emit(OpCode::PUSH_NUM, 0, static_cast<const NumberLiteral &>(node).getValue());
+            break;
+        case NodeType::STRING_LIT: {
+            const auto &value = static_cast<const StringLiteral &>(node).getValue();
+            m_chunk.constants.emplace_back(value);
+            emit(OpCode::PUSH_CONST, static_cast<std::uint32_t>(m_chunk.constants.size() - 1));
+            break;
+        }
+        case NodeType::BOOLEAN_LIT:
+            emit(static_cast<const BooleanLiteral &>(node).getValue() ? OpCode::PUSH_TRUE : OpCode::PUSH_FALSE);
+            break;
+        case NodeType::NIL_LIT:
+            emit(OpCode::PUSH_NIL);
+            break;
+        case NodeType::IDENT_LIT:
+            emit(OpCode::LOAD_VAR, static_cast<std::uint32_t>(static_cast<const IdentifierLiteral &>(node).getSlot()));
+            break;
+        case NodeType::BINARY_EXPR: {
+            const auto &bin = static_cast<const BinaryExpr &>(node);
+            const auto op = bin.getOp();
+            emitNode(bin.getLeft());
+
+            if (op == BinaryOp::AND || op == BinaryOp::OR) {
+                const auto jump = m_chunk.code.size();
+                emit(op == BinaryOp::AND ? OpCode::JUMP_IF_FALSE_OR_POP : OpCode::JUMP_IF_TRUE_OR_POP);
+                emitNode(bin.getRight());
+                if (typeOf(bin.getRight()) != StaticType::BOOL)
+                    emit(OpCode::TO_BOOL);
+                patch(jump);
+                break;
+            }
+
+            emitNode(bin.getRight());
+            const auto typed = typedOp(op, typeOf(bin.getLeft()), typeOf(bin.getRight()));
+            emit(typed, typed == OpCode::BINARY ? static_cast<std::uint32_t>(op) : 0);
+            break;
+        }
+        case NodeType::CONDITIONAL_EXPR: {
+            const auto &cond = static_cast<const ConditionalExpr &>(node);
+            emitNode(cond.getCondition());
+
+            const auto toElse = m_chunk.code.size();
+            emit(OpCode::JUMP_IF_FALSE);
+            emitNode(cond.getThen());
+
+            const auto toEnd = m_chunk.code.size();
+            emit(OpCode::JUMP);
+
+            // Only one branch runs; the else value takes the then value's place
+            --m_depth;
+            patch(toElse);
+            emitNode(cond.getElse());
+            patch(toEnd);
+            break;
+        }
+        default:
+            throw std::runtime_error(std::format("Cannot compile node `{}` to bytecode", node.name));
+    }
+}
+
+OpCode BytecodeCompiler::typedOp(const BinaryOp op, const StaticType l, const StaticType r) {
+    if (l == StaticType::STRING && r == StaticType::STRING && op == BinaryOp::ADD)
+        return OpCode::CONCAT;
+
+    if (l != StaticType::NUMBER || r != StaticType::NUMBER)
+        return OpCode::BINARY;
+
+    switch (op) {
+        case BinaryOp::ADD: return OpCode::ADD_NUM;
+        case BinaryOp::SUB: return OpCode::SUB_NUM;
+        case BinaryOp::MUL: return OpCode::MUL_NUM;
+        case BinaryOp::DIV: return OpCode::DIV_NUM;
+        case BinaryOp::MOD: return OpCode::MOD_NUM;
+        case BinaryOp::EQ: return OpCode::EQ_NUM;
+        case BinaryOp::NEQ: return OpCode::NEQ_NUM;
+        case BinaryOp::LT: return OpCode::LT_NUM;
+        case BinaryOp::LT_EQ: return OpCode::LT_EQ_NUM;
+        case BinaryOp::GT: return OpCode::GT_NUM;
+        case BinaryOp::GT_EQ: return OpCode::GT_EQ_NUM;
+        default: return OpCode::BINARY;
+    }
+}
+
+StaticType BytecodeCompiler::typeOf(const Node &node) const {
+    return m_types ? m_types->typeOf(node) : StaticType::ANY;
+}
+
+void BytecodeCompiler::emit(const OpCode op, const std::uint32_t arg, const double num) {
+    m_chunk.code.push_back(Instr{op, arg, num});
+
+    // Track the stack high-water mark so the VM can size its stack once
+    switch (op) {
+        case OpCode::PUSH_NUM:
+        case OpCode::PUSH_CONST:
+        case OpCode::PUSH_TRUE:
+        case OpCode::PUSH_FALSE:
+        case OpCode::PUSH_NIL:
+        case OpCode::LOAD_VAR:
+            ++m_depth;
+            break;
+        case OpCode::RETURN:
+        case OpCode::JUMP:
+        case OpCode::TO_BOOL:
+            break;
+        default: // binary ops, POP and the conditional jumps, which pop when falling through
+            --m_depth;
+            break;
+    }
+
+    if (m_depth > m_chunk.maxStack)
+        m_chunk.maxStack = m_depth;
+}
+
+void BytecodeCompiler::patch(const std::size_t at) {
+    m_chunk.code[at].arg = static_cast<std::uint32_t>(m_chunk.code.size());
+}
@@ -0,0 +1,107 @@
+#include "../../include/expr-eval/backend/compiled_expr.h"
+#include "../../include/expr-eval/backend/vm.h"
+
+#include <stdexcept>
+#include <format>
+
+CompiledExpr::CompiledExpr(std::string src, std::shared_ptr<const Program> program,
+                           const Engine engine, const OptimizerStats stats)
+    : m_src(std::move(src)),
+      m_engine(engine),
+      m_stats(stats),
+      m_program(std::move(program)),
+      m_slotCount(m_program->slotCount()) {
+    if (m_engine == Engine::BYTECODE)
+        m_chunk = std::make_shared<const Chunk>(BytecodeCompiler::compile(*m_program));
+    else if (m_engine == Engine::JIT)
+        m_jit = JitCompiler::compile(*m_program);
+}
+
+CompiledExpr::CompiledExpr(std::string src, std::shared_ptr<const Program> program,
+                           const TypeChecker &types, const OptimizerStats stats)
+    : m_src(std::move(src)),
+      m_engine(Engine::BYTECODE),
+      m_stats(stats),
+      m_program(std::move(program)),
+      m_slotCount(m_program->slotCount()),
+      m_chunk(std::make_shared<const Chunk>(BytecodeCompiler::compile(*m_program, &types))),
+      m_inputs(std::make_shared<const std::vector<TypeChecker::Input> >(types.inputs())),
+      m_resultType(types.typeOf(*m_program)) {
+}
+
+RuntimeVar CompiledExpr::eval(const std::span<const RuntimeVar> slots) const {
+    checkSlots(slots);
+    if (m_inputs)
+        checkInputs(slots);
+
+    if (m_engine == Engine::BYTECODE) {
+        thread_local VM vm;
+        return vm.run(*m_chunk, slots);
+    }
+
+    return evalTree(slots);
+}
+
+RuntimeVar CompiledExpr::eval(EvalContext &ctx) const {
+    checkSlots(ctx.values());
+    if (m_inputs)
+        checkInputs(ctx.values());
+
+    if (m_engine == Engine::BYTECODE)
+        return ctx.vm().run(*m_chunk, ctx.values());
+
+    return evalTree(ctx.values());
+}
+
+RuntimeVar CompiledExpr::evalTree(const std::span<const RuntimeVar> slots) const {
+    if (m_jit) {
+        if (auto res = m_jit->eval(slots))
+            return std::move(*res);
+    }
+
+    return m_program->eval(slots);
+}
+
+void CompiledExpr::checkSlots(const std::span<const RuntimeVar> slots) const {
+    if (slots.size() < m_slotCount)
+        throw std::runtime_error(std::format("Expression reads variable slot {} but only {} values were given",
+                                             m_slotCount - 1, slots.size()));
+}
+
+void CompiledExpr::checkInputs(const std::span<const RuntimeVar> slots) const {
+    for (const auto &input: *m_inputs) {
+        const auto &value = slots[input.slot];
+        if (value.type != input.type)
+            throw std::runtime_error(std::format("Variable `{}` is declared {} but holds {}",
+                                                 input.name, staticTypeStr(static_cast<StaticType>(input.type)),
+                                                 value.typeStr()));
+    }
+}
+
+const std::string &CompiledExpr::source() const {
+    return m_src;
+}
+
+Engine CompiledExpr::engine() const {
+    return m_engine;
+}
+
+const OptimizerStats &CompiledExpr::optimizerStats() const {
+    return m_stats;
+}
+
+const Program &CompiledExpr::program() const {
+    return *m_program;
+}
+
+StaticType CompiledExpr::resultType() const {
+    return m_resultType;
+}
+
+const JitCode *CompiledExpr::jit() const {
+    return m_jit.get();
+}
+
+picojson::value CompiledExpr::dump() const {
+    return m_program->dump();
+}
@@ -0,0 +1,55 @@
+#include "../../include/expr-eval/backend/eval_context.h"
+
+#include <atomic>
+
+// Stamps are handed out to each thread in blocks, so writes stay free of
+// contention while no two writes anywhere share a stamp
+static std::uint64_t nextStamp() {
+    constexpr std::uint64_t block = 1 << 16;
+    static std::atomic<std::uint64_t> next{1};
+    thread_local std::uint64_t cur = 0, end = 0;
+
+    if (cur == end) {
+        cur = next.fetch_add(block, std::memory_order_relaxed);
+        end = cur + block;
+    }
+    return cur++;
+}
+
+EvalContext::EvalContext(const std::span<const RuntimeVar> values)
+    : m_values(values.begin(), values.end()) {
+    m_versions.reserve(m_values.size());
+    for (std::size_t i = 0; i < m_values.size(); ++i)
+        m_versions.push_back(nextStamp());
+}
+
+void EvalContext::set(const std::size_t slot, RuntimeVar value) {
+    if (slot >= m_values.size()) {
+        m_values.resize(slot + 1);
+        while (m_versions.size() < m_values.size())
+            m_versions.push_back(nextStamp());
+    }
+
+    m_values[slot] = std::move(value);
+    m_versions[slot] = nextStamp();
+}
+
+const RuntimeVar &EvalContext::get(const std::size_t slot) const {
+    return m_values.at(slot);
+}
+
+std::span<const RuntimeVar> EvalContext::values() const {
+    return m_values;
+}
+
+std::span<const std::uint64_t> EvalContext::versions() const {
+    return m_versions;
+}
+
+VM &EvalContext::vm() {
+    return m_vm;
+}
+
+std::vector<double> &EvalContext::batchScratch() {
+    return m_batchScratch;
+}
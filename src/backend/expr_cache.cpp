@@ -0,0 +1,60 @@
+#include "../../include/expr-eval/backend/expr_cache.h"
+
+ExprCache::ExprCache(const std::size_t capacity) : m_capacity(capacity) {}
+
+const CompiledExpr *ExprCache::find(const std::string_view src) {
+    const auto it = m_index.find(src);
+    if (it == m_index.end()) {
+        ++m_stats.misses;
+        return nullptr;
+    }
+
+    ++m_stats.hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return &*it->second;
+}
+
+const CompiledExpr &ExprCache::insert(CompiledExpr expr) {
+    if (const auto it = m_index.find(expr.source()); it != m_index.end()) {
+        const auto entry = it->second;
+        m_index.erase(it);
+        m_entries.erase(entry);
+    }
+
+    // Always keep the entry being returned, even at capacity zero
+    evictTo(m_capacity == 0 ? 0 : m_capacity - 1);
+
+    m_entries.push_front(std::move(expr));
+    m_index.emplace(m_entries.front().source(), m_entries.begin());
+    return m_entries.front();
+}
+
+void ExprCache::clear() {
+    m_index.clear();
+    m_entries.clear();
+}
+
+void ExprCache::setCapacity(const std::size_t capacity) {
+    m_capacity = capacity;
+    evictTo(capacity);
+}
+
+std::size_t ExprCache::capacity() const {
+    return m_capacity;
+}
+
+std::size_t ExprCache::size() const {
+    return m_index.size();
+}
+
+const ExprCacheStats &ExprCache::stats() const {
+    return m_stats;
+}
+
+void ExprCache::evictTo(const std::size_t size) {
+    while (m_index.size() > size) {
+        m_index.erase(m_entries.back().source());
+        m_entries.pop_back();
+        ++m_stats.evictions;
+    }
+}
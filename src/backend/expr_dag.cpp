@@ -0,0 +1,242 @@
+#include "../../include/expr-eval/backend/expr_dag.h"
+#include "../../include/expr-eval/backend/trace.h"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <stdexcept>
+#include <unordered_map>
+
+// ----- BUILDER ----- //
+// Interns nodes bottom-up: a node's key is its type, operator, payload
+// and the ids of its already interned children, so equal keys mean
+// equal subtrees.
+class ExprDag::Builder {
+public:
+    explicit Builder(std::vector<DagNode> &nodes) : m_nodes(nodes) {
+    }
+
+    std::uint32_t add(const Node &node) {
+        DagNode dag{node.type};
+        Key key{node.type};
+
+        switch (node.type) {
+            case NodeType::BINARY_EXPR: {
+                const auto &bin = static_cast<const BinaryExpr &>(node);
+                dag.op = bin.getOp();
+                dag.children[0] = add(bin.getLeft());
+                dag.children[1] = add(bin.getRight());
+                break;
+            }
+            case NodeType::CONDITIONAL_EXPR: {
+                const auto &cond = static_cast<const ConditionalExpr &>(node);
+                dag.children[0] = add(cond.getCondition());
+                dag.children[1] = add(cond.getThen());
+                dag.children[2] = add(cond.getElse());
+                break;
+            }
+            case NodeType::NUMBER_LIT: {
+                const auto d = static_cast<const NumberLiteral &>(node).getValue();
+                dag.value = RuntimeVar{d};
+                key.payload = std::bit_cast<std::uint64_t>(d);
+                break;
+            }
+            case NodeType::BOOLEAN_LIT: {
+                const auto b = static_cast<const BooleanLiteral &>(node).getValue();
+                dag.value = RuntimeVar{b};
+                key.payload = b;
+                break;
+            }
+            case NodeType::STRING_LIT: {
+                const auto &str = static_cast<const StringLiteral &>(node).getValue();
+                const auto [it, inserted] = m_strings.try_emplace(str, m_strings.size());
+                dag.value = RuntimeVar{str};
+                key.payload = it->second;
+                break;
+            }
+            case NodeType::IDENT_LIT:
+                dag.slot = static_cast<const IdentifierLiteral &>(node).getSlot();
+                key.payload = dag.slot;
+                break;
+            case NodeType::NIL_LIT:
+                break;
+            default:
+                throw std::runtime_error(std::format("Unexpected {} in expression", node.name));
+        }
+
+        key.op = dag.op;
+        std::copy(std::begin(dag.children), std::end(dag.children), key.children);
+
+        const auto [it, inserted] = m_index.try_emplace(key, static_cast<std::uint32_t>(m_nodes.size()));
+        if (inserted)
+            m_nodes.push_back(std::move(dag));
+
+        return it->second;
+    }
+
+private:
+    struct Key {
+        explicit Key(const NodeType type) : type(type) {
+        }
+
+        NodeType type;
+        BinaryOp op = BinaryOp::ADD;
+        std::uint32_t children[3] = {kNone, kNone, kNone};
+        std::uint64_t payload = 0; // number bits, bool, string id or slot
+
+        bool operator==(const Key &) const = default;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const {
+            std::uint64_t h = 0xcbf29ce484222325ull;
+            auto mix = [&](const std::uint64_t v) { h = (h ^ v) * 0x100000001b3ull; };
+            mix(static_cast<std::uint64_t>(key.type) << 8 | static_cast<std::uint64_t>(key.op));
+            for (const auto child: key.children)
+                mix(child);
+            mix(key.payload);
+            return h;
+        }
+    };
+
+    std::vector<DagNode> &m_nodes;
+    std::unordered_map<Key, std::uint32_t, KeyHash> m_index;
+    std::unordered_map<std::string, std::uint64_t> m_strings;
+};
+
+static std::size_t countNodes(const Node &node) {
+    switch (node.type) {
+        case NodeType::BINARY_EXPR: {
+            const auto &bin = static_cast<const BinaryExpr &>(node);
+            return 1 + countNodes(bin.getLeft()) + countNodes(bin.getRight());
+        }
+        case NodeType::CONDITIONAL_EXPR: {
+            const auto &cond = static_cast<const ConditionalExpr &>(node);
+            return 1 + countNodes(cond.getCondition()) + countNodes(cond.getThen()) + countNodes(cond.getElse());
+        }
+        default:
+            return 1;
+    }
+}
+
+// ----- EXPR DAG ----- //
+ExprDag::ExprDag(const std::span<const CompiledExpr> exprs) {
+    Builder builder{m_nodes};
+
+    m_roots.reserve(exprs.size());
+    for (const auto &expr: exprs) {
+        const auto &program = expr.program();
+        auto &root = m_roots.emplace_back();
+        for (const auto *stmt: program.getNodes()) {
+            root.push_back(builder.add(*stmt));
+            m_stats.treeNodes += countNodes(*stmt);
+        }
+        m_stats.treeNodes += 1; // the Program itself
+        m_slotCount = std::max(m_slotCount, program.slotCount());
+        m_stats.treeBytes += sizeof(Program) + program.arena().bytesUsed();
+    }
+
+    m_nodes.shrink_to_fit();
+    m_memo.resize(m_nodes.size());
+    m_errors.resize(exprs.size());
+
+    // Only operators are worth memoizing: a leaf is as cheap to read
+    // again as its memo. A node is counted once per distinct parent (or
+    // per operand slot, for `a * a`), so the subtree of a shared node
+    // is not memoized unless it is reached some other way too.
+    std::vector<std::uint32_t> parents(m_nodes.size());
+    for (const auto &node: m_nodes) {
+        for (const auto child: node.children)
+            if (child != kNone) ++parents[child];
+    }
+    for (const auto &root: m_roots) {
+        for (const auto stmt: root)
+            ++parents[stmt];
+    }
+
+    m_stats.exprs = exprs.size();
+    m_stats.dagNodes = m_nodes.size();
+    for (std::size_t id = 0; id < m_nodes.size(); ++id) {
+        auto &node = m_nodes[id];
+        node.shared = parents[id] > 1 && (node.type == NodeType::BINARY_EXPR
+                                          || node.type == NodeType::CONDITIONAL_EXPR);
+        m_stats.sharedNodes += node.shared;
+    }
+
+    m_stats.dagBytes = m_nodes.size() * (sizeof(DagNode) + sizeof(Memo))
+                       + m_roots.size() * sizeof(m_roots[0]);
+    for (const auto &root: m_roots)
+        m_stats.dagBytes += root.capacity() * sizeof(root[0]);
+}
+
+std::size_t ExprDag::eval(const std::span<const RuntimeVar> slots, const std::span<RuntimeVar> out) {
+    TRACE_SCOPE("ExprDag::eval");
+    if (out.size() < m_roots.size())
+        throw std::runtime_error(std::format("ExprDag::eval needs room for {} results, got {}",
+                                             m_roots.size(), out.size()));
+
+    if (slots.size() < m_slotCount)
+        throw std::runtime_error(std::format("Expressions read variable slot {} but only {} values were given",
+                                             m_slotCount - 1, slots.size()));
+
+    ++m_pass;
+    std::size_t failed = 0;
+
+    for (std::size_t i = 0; i < m_roots.size(); ++i) {
+        m_errors[i].clear();
+        try {
+            RuntimeVar res;
+            for (const auto stmt: m_roots[i])
+                res = evalNode(stmt, slots);
+            out[i] = std::move(res);
+        } catch (const std::exception &e) {
+            out[i] = RuntimeVar{};
+            m_errors[i] = e.what();
+            ++failed;
+        }
+    }
+
+    return failed;
+}
+
+RuntimeVar ExprDag::evalNode(const std::uint32_t id, const std::span<const RuntimeVar> slots) {
+    const auto &node = m_nodes[id];
+    if (!node.shared)
+        return compute(node, slots);
+
+    // A node that threw is not memoized and throws again for each
+    // expression that reaches it, as it would in separate Programs
+    auto &memo = m_memo[id];
+    if (memo.pass != m_pass) {
+        memo.value = compute(node, slots);
+        memo.pass = m_pass;
+    }
+    return memo.value;
+}
+
+RuntimeVar ExprDag::compute(const DagNode &node, const std::span<const RuntimeVar> slots) {
+    auto child = [&](const std::size_t i) { return evalNode(node.children[i], slots); };
+
+    switch (node.type) {
+        case NodeType::BINARY_EXPR:
+            return evalBinary(node.op, binaryKernels(node.op), child);
+        case NodeType::CONDITIONAL_EXPR:
+            return evalConditional(child);
+        case NodeType::IDENT_LIT:
+            return slots[node.slot];
+        default: // literals
+            return node.value;
+    }
+}
+
+std::size_t ExprDag::size() const {
+    return m_roots.size();
+}
+
+const std::string &ExprDag::error(const std::size_t i) const {
+    return m_errors.at(i);
+}
+
+const DagStats &ExprDag::stats() const {
+    return m_stats;
+}
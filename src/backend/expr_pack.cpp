@@ -0,0 +1,416 @@
+#include "../../include/expr-eval/backend/expr_pack.h"
+#include "../../include/expr-eval/backend/ops.h"
+#include "../../include/expr-eval/backend/vm.h"
+#include "../../include/expr-eval/backend/trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <format>
+
+// ----- FILE LAYOUT ----- //
+static constexpr char kMagic[8] = {'E', 'X', 'P', 'R', 'P', 'A', 'C', 'K'};
+static constexpr std::uint32_t kByteOrder = 0x01020304;
+
+struct PackHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder; // kByteOrder as written by the saving machine
+    std::uint32_t instrSize;
+    std::uint32_t symbolCount;
+    std::uint32_t exprCount;
+    std::uint32_t constCount;
+    std::uint64_t codeCount; // Instr records over all expressions
+    std::uint64_t stringBytes;
+    std::uint64_t fileSize;
+    std::uint64_t checksum; // over everything after the header
+};
+
+// Byte range in the string section
+struct PackString {
+    std::uint64_t offset;
+    std::uint64_t length;
+};
+
+struct PackExpr {
+    std::uint64_t codeBegin;
+    std::uint32_t codeCount;
+    std::uint32_t constBegin;
+    std::uint32_t constCount;
+    std::uint32_t maxStack;
+    PackString source;
+};
+
+enum class PackConstType : std::uint32_t {
+    NIL,
+    NUMBER,
+    BOOL,
+    STRING
+};
+
+struct PackConst {
+    PackConstType type;
+    std::uint32_t reserved;
+    double num; // NUMBER, or BOOL as 0/1
+    PackString str; // STRING
+};
+
+// No padding anywhere, so records can be written with memcpy and read in place
+static_assert(sizeof(PackHeader) == 64 && sizeof(PackExpr) == 40 && sizeof(PackConst) == 32);
+
+static std::uint64_t align8(const std::uint64_t n) {
+    return (n + 7) & ~std::uint64_t{7};
+}
+
+// FNV-1a over 64-bit words, then the tail bytes
+static std::uint64_t checksum(const std::string_view bytes) {
+    constexpr std::uint64_t prime = 0x100000001b3;
+    std::uint64_t h = 0xcbf29ce484222325;
+
+    std::size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes.data() + i, 8);
+        h = (h ^ word) * prime;
+    }
+    for (; i < bytes.size(); ++i)
+        h = (h ^ static_cast<unsigned char>(bytes[i])) * prime;
+    return h;
+}
+
+[[noreturn]] static void invalid(const std::string &path, const std::string_view what) {
+    throw std::runtime_error(std::format("Invalid expression pack `{}`: {}", path, what));
+}
+
+// ----- SAVE ----- //
+void ExprPack::save(const std::string &path, const std::span<const CompiledExpr> exprs, const SymbolTable &symbols) {
+    std::vector<PackString> names;
+    std::vector<PackExpr> table;
+    std::vector<PackConst> constants;
+    std::vector<Instr> code;
+    std::string strings;
+
+    auto addString = [&](const std::string_view s) {
+        const PackString res{strings.size(), s.size()};
+        strings += s;
+        return res;
+    };
+
+    for (std::size_t slot = 0; slot < symbols.size(); ++slot)
+        names.push_back(addString(symbols.name(slot)));
+
+    for (const auto &expr: exprs) {
+        const auto chunk = BytecodeCompiler::compile(expr.program());
+
+        table.push_back(PackExpr{
+            code.size(), static_cast<std::uint32_t>(chunk.code.size()),
+            static_cast<std::uint32_t>(constants.size()), static_cast<std::uint32_t>(chunk.constants.size()),
+            static_cast<std::uint32_t>(chunk.maxStack), addString(expr.source())
+        });
+
+        for (const auto &value: chunk.constants) {
+            PackConst c{};
+            switch (value.type) {
+                case RuntimeVar::RuntimeVarType::NUMBER: c.type = PackConstType::NUMBER; c.num = value.d_value; break;
+                case RuntimeVar::RuntimeVarType::BOOL: c.type = PackConstType::BOOL; c.num = value.b_value; break;
+                case RuntimeVar::RuntimeVarType::STRING: c.type = PackConstType::STRING; c.str = addString(value.str()); break;
+                default: c.type = PackConstType::NIL; break;
+            }
+            constants.push_back(c);
+        }
+
+        code.insert(code.end(), chunk.code.begin(), chunk.code.end());
+    }
+
+    // Assemble the file in memory; sections start on 8-byte boundaries
+    std::string out(sizeof(PackHeader), '\0');
+    auto append = [&](const void *data, const std::size_t size) {
+        out.resize(align8(out.size()), '\0');
+        out.append(static_cast<const char *>(data), size);
+    };
+
+    append(names.data(), names.size() * sizeof(PackString));
+    append(table.data(), table.size() * sizeof(PackExpr));
+    append(constants.data(), constants.size() * sizeof(PackConst));
+
+    // Instr has padding after `op`; write each record with it zeroed
+    out.resize(align8(out.size()), '\0');
+    for (const auto &instr: code) {
+        char rec[sizeof(Instr)] = {};
+        rec[offsetof(Instr, op)] = static_cast<char>(instr.op);
+        std::memcpy(rec + offsetof(Instr, arg), &instr.arg, sizeof instr.arg);
+        std::memcpy(rec + offsetof(Instr, num), &instr.num, sizeof instr.num);
+        out.append(rec, sizeof rec);
+    }
+
+    append(strings.data(), strings.size());
+
+    PackHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof kMagic);
+    header.version = kVersion;
+    header.byteOrder = kByteOrder;
+    header.instrSize = sizeof(Instr);
+    header.symbolCount = static_cast<std::uint32_t>(names.size());
+    header.exprCount = static_cast<std::uint32_t>(table.size());
+    header.constCount = static_cast<std::uint32_t>(constants.size());
+    header.codeCount = code.size();
+    header.stringBytes = strings.size();
+    header.fileSize = out.size();
+    header.checksum = checksum(std::string_view{out}.substr(sizeof(PackHeader)));
+    std::memcpy(out.data(), &header, sizeof header);
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!file.flush())
+        throw std::runtime_error(std::format("Cannot write expression pack `{}`", path));
+}
+
+// ----- LOAD ----- //
+// Walks the code once, tracking the operand stack depth at every
+// instruction. The compiler only emits forward jumps, so every edge into
+// an instruction is seen before the instruction itself. Returns the
+// maximum depth, after checking that no path underflows the stack, reads
+// a constant or slot out of range, or runs past the end of the code.
+static std::size_t verifyCode(const std::span<const Instr> code, const std::size_t constCount,
+                              const std::size_t slotCount, std::vector<std::int64_t> &depth,
+                              const std::string &path) {
+    depth.assign(code.size(), -1); // -1 until reached
+    std::int64_t maxDepth = 0;
+
+    auto flow = [&](const std::size_t target, const std::int64_t d) {
+        if (target >= code.size())
+            invalid(path, "code runs past its end");
+        if (depth[target] == -1)
+            depth[target] = d;
+        else if (depth[target] != d)
+            invalid(path, "inconsistent stack depth at a jump target");
+    };
+
+    if (!code.empty())
+        depth[0] = 0;
+
+    for (std::size_t i = 0; i < code.size(); ++i) {
+        const auto d = depth[i];
+        if (d < 0)
+            continue; // unreachable, never executed
+
+        const auto &instr = code[i];
+        auto need = [&](const std::int64_t n) {
+            if (d < n)
+                invalid(path, "stack underflow");
+        };
+        auto jumpTarget = [&] {
+            if (instr.arg <= i)
+                invalid(path, "backward jump");
+            return static_cast<std::size_t>(instr.arg);
+        };
+
+        std::int64_t next;
+        switch (instr.op) {
+            case OpCode::PUSH_NUM:
+            case OpCode::PUSH_TRUE:
+            case OpCode::PUSH_FALSE:
+            case OpCode::PUSH_NIL:
+                next = d + 1;
+                break;
+            case OpCode::PUSH_CONST:
+                if (instr.arg >= constCount)
+                    invalid(path, "constant index out of range");
+                next = d + 1;
+                break;
+            case OpCode::LOAD_VAR:
+                if (instr.arg >= slotCount)
+                    invalid(path, "variable slot out of range");
+                next = d + 1;
+                break;
+            case OpCode::BINARY:
+                if (instr.arg >= kBinaryOpCount)
+                    invalid(path, "unknown binary operator");
+                need(2);
+                next = d - 1;
+                break;
+            case OpCode::JUMP:
+                flow(jumpTarget(), d);
+                continue;
+            case OpCode::JUMP_IF_FALSE:
+                need(1);
+                flow(jumpTarget(), d - 1);
+                next = d - 1;
+                break;
+            case OpCode::JUMP_IF_FALSE_OR_POP:
+            case OpCode::JUMP_IF_TRUE_OR_POP:
+                need(1);
+                flow(jumpTarget(), d);
+                next = d - 1;
+                break;
+            case OpCode::TO_BOOL:
+                need(1);
+                next = d;
+                break;
+            case OpCode::POP:
+                need(1);
+                next = d - 1;
+                break;
+            case OpCode::RETURN:
+                need(1);
+                continue;
+            default:
+                invalid(path, "unknown opcode");
+        }
+
+        maxDepth = std::max(maxDepth, next);
+        flow(i + 1, next);
+    }
+
+    return static_cast<std::size_t>(maxDepth);
+}
+
+ExprPack::ExprPack(MappedFile file) : m_file(std::move(file)) {
+}
+
+ExprPack ExprPack::load(const std::string &path, const SymbolTable &symbols) {
+    TRACE_SCOPE("ExprPack::load");
+    ExprPack pack{MappedFile{path}};
+    const auto bytes = pack.m_file.view();
+
+    if (bytes.size() < sizeof(PackHeader))
+        invalid(path, "truncated header");
+
+    PackHeader header;
+    std::memcpy(&header, bytes.data(), sizeof header);
+
+    if (std::memcmp(header.magic, kMagic, sizeof kMagic) != 0)
+        invalid(path, "not an expression pack");
+    if (header.byteOrder != kByteOrder)
+        invalid(path, "written on a machine with a different byte order");
+    if (header.version != kVersion)
+        invalid(path, std::format("format version {}, expected {}", header.version, kVersion));
+    if (header.instrSize != sizeof(Instr))
+        invalid(path, "instruction layout differs from this build");
+    if (header.fileSize != bytes.size())
+        invalid(path, "file size does not match the header");
+    if (header.checksum != checksum(bytes.substr(sizeof(PackHeader))))
+        invalid(path, "checksum mismatch");
+
+    // Section offsets, bounded by the file size before anything is read
+    std::uint64_t pos = sizeof(PackHeader);
+    auto section = [&](const std::uint64_t count, const std::size_t elemSize) {
+        pos = align8(pos);
+        if (pos > bytes.size() || count > (bytes.size() - pos) / elemSize)
+            invalid(path, "section exceeds the file");
+        const auto *begin = bytes.data() + pos;
+        pos += count * elemSize;
+        return begin;
+    };
+
+    const auto *names = reinterpret_cast<const PackString *>(section(header.symbolCount, sizeof(PackString)));
+    const auto *table = reinterpret_cast<const PackExpr *>(section(header.exprCount, sizeof(PackExpr)));
+    const auto *constants = reinterpret_cast<const PackConst *>(section(header.constCount, sizeof(PackConst)));
+    const auto *code = reinterpret_cast<const Instr *>(section(header.codeCount, sizeof(Instr)));
+    const auto strings = std::string_view{section(header.stringBytes, 1), header.stringBytes};
+    if (pos != bytes.size())
+        invalid(path, "trailing bytes");
+
+    auto string = [&](const PackString &s) {
+        if (s.length > strings.size() || s.offset > strings.size() - s.length)
+            invalid(path, "string out of range");
+        return strings.substr(s.offset, s.length);
+    };
+
+    // Slots are resolved by name; code is only rewritten if they moved
+    std::vector<std::uint32_t> slotMap(header.symbolCount);
+    bool relocate = false;
+    for (std::uint32_t i = 0; i < header.symbolCount; ++i) {
+        const auto name = string(names[i]);
+        const auto slot = symbols.lookup(name);
+        if (!slot)
+            throw std::runtime_error(std::format("Expression pack `{}` uses undeclared variable `{}`", path, name));
+
+        slotMap[i] = static_cast<std::uint32_t>(*slot);
+        relocate |= *slot != i;
+    }
+
+    pack.m_constants.reserve(header.constCount);
+    for (std::uint32_t i = 0; i < header.constCount; ++i) {
+        const auto &c = constants[i];
+        switch (c.type) {
+            case PackConstType::NIL: pack.m_constants.emplace_back(); break;
+            case PackConstType::NUMBER: pack.m_constants.emplace_back(c.num); break;
+            case PackConstType::BOOL: pack.m_constants.emplace_back(c.num != 0.0); break;
+            case PackConstType::STRING: pack.m_constants.emplace_back(std::string{string(c.str)}); break;
+            default: invalid(path, "unknown constant type");
+        }
+    }
+
+    const std::span allCode{code, header.codeCount};
+    if (relocate) {
+        pack.m_relocatedCode.assign(allCode.begin(), allCode.end());
+        for (auto &instr: pack.m_relocatedCode) {
+            if (instr.op == OpCode::LOAD_VAR && instr.arg < slotMap.size())
+                instr.arg = slotMap[instr.arg];
+        }
+    }
+    const Instr *runCode = relocate ? pack.m_relocatedCode.data() : code;
+
+    pack.m_entries.reserve(header.exprCount);
+    std::vector<std::int64_t> depths;
+    for (std::uint32_t i = 0; i < header.exprCount; ++i) {
+        const auto &e = table[i];
+        if (e.codeCount == 0 || e.codeBegin > header.codeCount || e.codeCount > header.codeCount - e.codeBegin)
+            invalid(path, "code range out of bounds");
+        if (e.constBegin > header.constCount || e.constCount > header.constCount - e.constBegin)
+            invalid(path, "constant range out of bounds");
+
+        // Verify the code as written, against the slots of the file
+        const auto depth = verifyCode(allCode.subspan(e.codeBegin, e.codeCount), e.constCount,
+                                      header.symbolCount, depths, path);
+        if (depth != e.maxStack)
+            invalid(path, "stack size does not match its code");
+
+        // Slots as renumbered for `symbols`, checked against the span on eval
+        std::size_t slotCount = 0;
+        for (std::size_t k = e.codeBegin; k < e.codeBegin + e.codeCount; ++k) {
+            if (runCode[k].op == OpCode::LOAD_VAR)
+                slotCount = std::max<std::size_t>(slotCount, runCode[k].arg + 1);
+        }
+
+        pack.m_entries.push_back(Entry{
+            ChunkView{runCode + e.codeBegin, pack.m_constants.data() + e.constBegin, depth},
+            string(e.source),
+            slotCount
+        });
+    }
+
+    return pack;
+}
+
+// ----- EVALUATION ----- //
+std::size_t ExprPack::size() const {
+    return m_entries.size();
+}
+
+std::string_view ExprPack::source(const std::size_t i) const {
+    return m_entries.at(i).source;
+}
+
+const ExprPack::Entry &ExprPack::entry(const std::size_t i, const std::span<const RuntimeVar> slots) const {
+    const auto &e = m_entries.at(i);
+    if (slots.size() < e.slotCount)
+        throw std::runtime_error(std::format("Expression reads variable slot {} but only {} values were given",
+                                             e.slotCount - 1, slots.size()));
+    return e;
+}
+
+RuntimeVar ExprPack::eval(const std::size_t i, const std::span<const RuntimeVar> slots) const {
+    thread_local VM vm;
+    return vm.run(entry(i, slots).chunk, slots);
+}
+
+RuntimeVar ExprPack::eval(const std::size_t i, EvalContext &ctx) const {
+    return ctx.vm().run(entry(i, ctx.values()).chunk, ctx.values());
+}
+
+bool ExprPack::relocated() const {
+    return !m_relocatedCode.empty();
+}
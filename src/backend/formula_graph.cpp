@@ -0,0 +1,282 @@
+#include "../../include/expr-eval/backend/formula_graph.h"
+#include "../../include/expr-eval/frontend/lexer.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <format>
+
+// Slots of every identifier the expression still reads after optimizing
+static void collectSlots(const Node &node, std::vector<std::size_t> &slots) {
+    switch (node.type) {
+        case NodeType::PROGRAM:
+            for (const auto *stmt: static_cast<const Program &>(node).getNodes())
+                collectSlots(*stmt, slots);
+            break;
+        case NodeType::BINARY_EXPR: {
+            const auto &bin = static_cast<const BinaryExpr &>(node);
+            collectSlots(bin.getLeft(), slots);
+            collectSlots(bin.getRight(), slots);
+            break;
+        }
+        case NodeType::CONDITIONAL_EXPR: {
+            const auto &cond = static_cast<const ConditionalExpr &>(node);
+            collectSlots(cond.getCondition(), slots);
+            collectSlots(cond.getThen(), slots);
+            collectSlots(cond.getElse(), slots);
+            break;
+        }
+        case NodeType::IDENT_LIT:
+            slots.push_back(static_cast<const IdentifierLiteral &>(node).getSlot());
+            break;
+        default:
+            break;
+    }
+}
+
+// Writing back an identical result would only make dependents recompute
+static bool sameValue(const RuntimeVar &a, const RuntimeVar &b) {
+    if (a.type != b.type)
+        return false;
+
+    switch (a.type) {
+        case RuntimeVar::RuntimeVarType::NUMBER:
+            return std::bit_cast<std::uint64_t>(a.d_value) == std::bit_cast<std::uint64_t>(b.d_value);
+        case RuntimeVar::RuntimeVarType::BOOL:
+            return a.b_value == b.b_value;
+        case RuntimeVar::RuntimeVarType::STRING:
+            return a.str() == b.str();
+        default:
+            return true;
+    }
+}
+
+FormulaGraph::FormulaGraph(Interpreter &ip) : m_ip(ip) {
+}
+
+void FormulaGraph::define(const std::string &name, const std::string &src) {
+    // Declare forward references so the parser accepts them
+    Lexer lexer;
+    for (const auto &token: lexer.tokenize(src)) {
+        if (token.type != TokenType::TOK_IDENT_LIT)
+            continue;
+
+        const std::string ident{lexer.text(token)};
+        if (!m_ip.symbols().lookup(ident))
+            m_ip.addVar(ident, RuntimeVar{});
+    }
+    if (!m_ip.symbols().lookup(name))
+        m_ip.addVar(name, RuntimeVar{});
+
+    auto expr = m_ip.compile(src);
+    const auto slot = m_ip.slotOf(name);
+
+    std::vector<std::size_t> inputs;
+    collectSlots(expr.program(), inputs);
+    std::sort(inputs.begin(), inputs.end());
+    inputs.erase(std::unique(inputs.begin(), inputs.end()), inputs.end());
+
+    checkCycle(slot, name, inputs);
+
+    if (const auto existing = formulaOf(slot)) {
+        auto &formula = m_formulas[*existing];
+        formula.expr = std::move(expr);
+        formula.seen.assign(inputs.size(), 0);
+        formula.inputs = std::move(inputs);
+        formula.stale = true;
+        formula.error.clear();
+    } else {
+        m_bySlot.emplace(slot, m_formulas.size());
+        std::vector<std::uint64_t> seen(inputs.size(), 0);
+        m_formulas.push_back(Formula{name, slot, std::move(expr), std::move(inputs), std::move(seen), true, {}});
+    }
+
+    m_levelsDirty = true;
+}
+
+std::optional<std::size_t> FormulaGraph::formulaOf(const std::size_t slot) const {
+    const auto it = m_bySlot.find(slot);
+    if (it == m_bySlot.end())
+        return std::nullopt;
+
+    return it->second;
+}
+
+void FormulaGraph::checkCycle(const std::size_t slot, const std::string &name,
+                              const std::vector<std::size_t> &inputs) const {
+    // Depth-first through the formulas the new definition would read,
+    // remembering how each slot was reached to report the cycle
+    std::unordered_map<std::size_t, std::size_t> via; // slot -> the formula slot that reads it
+    std::vector<std::size_t> stack;
+    for (const auto input: inputs) {
+        if (via.emplace(input, slot).second)
+            stack.push_back(input);
+    }
+
+    while (!stack.empty()) {
+        const auto current = stack.back();
+        stack.pop_back();
+
+        if (current == slot) {
+            // Walk back from the slot that reads `name` to `name` itself
+            std::string path = name;
+            for (auto at = via.at(slot); at != slot; at = via.at(at))
+                path = std::format("{} -> {}", m_ip.symbols().name(at), path);
+            throw std::runtime_error(std::format("Formula `{}` would create a cycle: {} -> {}", name, name, path));
+        }
+
+        const auto formula = formulaOf(current);
+        if (!formula)
+            continue;
+
+        for (const auto input: m_formulas[*formula].inputs) {
+            if (via.emplace(input, current).second)
+                stack.push_back(input);
+        }
+    }
+}
+
+// Kahn's algorithm; a formula's level is one past the deepest formula it reads
+void FormulaGraph::sortLevels() {
+    const auto n = m_formulas.size();
+    std::vector<std::size_t> level(n, 0), pending(n, 0);
+    std::vector<std::vector<std::size_t> > dependents(n);
+
+    for (std::size_t f = 0; f < n; ++f) {
+        for (const auto input: m_formulas[f].inputs) {
+            if (const auto from = formulaOf(input)) {
+                dependents[*from].push_back(f);
+                ++pending[f];
+            }
+        }
+    }
+
+    std::vector<std::size_t> ready;
+    for (std::size_t f = 0; f < n; ++f) {
+        if (pending[f] == 0)
+            ready.push_back(f);
+    }
+
+    m_levels.clear();
+    while (!ready.empty()) {
+        const auto f = ready.back();
+        ready.pop_back();
+
+        if (level[f] >= m_levels.size())
+            m_levels.resize(level[f] + 1);
+        m_levels[level[f]].push_back(f);
+
+        for (const auto d: dependents[f]) {
+            level[d] = std::max(level[d], level[f] + 1);
+            if (--pending[d] == 0)
+                ready.push_back(d);
+        }
+    }
+
+    m_levelsDirty = false;
+}
+
+RecomputeStats FormulaGraph::recompute() {
+    return run(nullptr);
+}
+
+RecomputeStats FormulaGraph::recompute(ThreadPool &pool) {
+    return run(&pool);
+}
+
+RecomputeStats FormulaGraph::run(ThreadPool *pool) {
+    if (m_levelsDirty)
+        sortLevels();
+
+    RecomputeStats stats;
+    stats.levels = m_levels.size();
+
+    std::vector<std::size_t> dirty;
+    std::vector<RuntimeVar> results;
+
+    for (const auto &level: m_levels) {
+        // Lower levels are written by now, so their changes are visible
+        const auto versions = m_ip.versions();
+
+        dirty.clear();
+        for (const auto f: level) {
+            const auto &formula = m_formulas[f];
+            bool changed = formula.stale;
+            for (std::size_t i = 0; i < formula.inputs.size() && !changed; ++i)
+                changed = versions[formula.inputs[i]] != formula.seen[i];
+
+            if (changed)
+                dirty.push_back(f);
+            else
+                ++stats.unchanged;
+        }
+
+        // Formulas of one level only read lower levels, so they can be
+        // evaluated at the same time; results are written back after
+        results.assign(dirty.size(), RuntimeVar{});
+        auto evalOne = [&](const std::size_t i) {
+            auto &formula = m_formulas[dirty[i]];
+            try {
+                results[i] = formula.expr.eval(m_ip.values());
+                formula.error.clear();
+            } catch (const std::exception &e) {
+                formula.error = e.what();
+            }
+        };
+
+        if (pool != nullptr && pool->size() > 1 && dirty.size() > 1) {
+            // One contiguous share per worker; a task per formula costs
+            // more than evaluating most formulas
+            const auto tasks = std::min(dirty.size(), pool->size());
+            pool->parallelFor(tasks, [&](const std::size_t t, std::size_t) {
+                for (auto i = t * dirty.size() / tasks; i < (t + 1) * dirty.size() / tasks; ++i)
+                    evalOne(i);
+            });
+        } else {
+            for (std::size_t i = 0; i < dirty.size(); ++i)
+                evalOne(i);
+        }
+
+        for (std::size_t i = 0; i < dirty.size(); ++i) {
+            auto &formula = m_formulas[dirty[i]];
+            for (std::size_t k = 0; k < formula.inputs.size(); ++k)
+                formula.seen[k] = versions[formula.inputs[k]];
+            formula.stale = false;
+
+            if (!formula.error.empty())
+                ++stats.errors;
+            if (!sameValue(m_ip.getVar(formula.slot), results[i]))
+                m_ip.setVar(formula.slot, std::move(results[i]));
+        }
+
+        stats.recomputed += dirty.size();
+    }
+
+    return stats;
+}
+
+std::size_t FormulaGraph::size() const {
+    return m_formulas.size();
+}
+
+std::optional<std::string> FormulaGraph::error(const std::string &name) const {
+    const auto slot = m_ip.symbols().lookup(name);
+    const auto formula = slot ? formulaOf(*slot) : std::nullopt;
+    if (!formula || m_formulas[*formula].error.empty())
+        return std::nullopt;
+
+    return m_formulas[*formula].error;
+}
+
+std::vector<std::vector<std::string> > FormulaGraph::levels() {
+    if (m_levelsDirty)
+        sortLevels();
+
+    std::vector<std::vector<std::string> > res;
+    for (const auto &level: m_levels) {
+        auto &names = res.emplace_back();
+        for (const auto f: level)
+            names.push_back(m_formulas[f].name);
+    }
+    return res;
+}
@@ -0,0 +1,124 @@
+#include "../../include/expr-eval/backend/incremental.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <format>
+
+IncrementalExpr::IncrementalExpr(CompiledExpr expr) : m_expr(std::move(expr)) {
+    add(m_expr.program(), kNoParent);
+}
+
+std::size_t IncrementalExpr::add(const Node &node, const std::size_t parent) {
+    const auto index = m_entries.size();
+    m_entries.push_back(Entry{&node, parent, {}, {}, {}, false});
+
+    switch (node.type) {
+        case NodeType::PROGRAM:
+            for (const auto *stmt: static_cast<const Program &>(node).getNodes()) {
+                const auto child = add(*stmt, index);
+                m_entries[index].body.push_back(child);
+            }
+            break;
+        case NodeType::BINARY_EXPR: {
+            const auto &bin = static_cast<const BinaryExpr &>(node);
+            const auto left = add(bin.getLeft(), index);
+            const auto right = add(bin.getRight(), index);
+            m_entries[index].children[0] = left;
+            m_entries[index].children[1] = right;
+            break;
+        }
+        case NodeType::CONDITIONAL_EXPR: {
+            const auto &cond = static_cast<const ConditionalExpr &>(node);
+            const auto c = add(cond.getCondition(), index);
+            const auto t = add(cond.getThen(), index);
+            const auto e = add(cond.getElse(), index);
+            m_entries[index].children[0] = c;
+            m_entries[index].children[1] = t;
+            m_entries[index].children[2] = e;
+            break;
+        }
+        case NodeType::IDENT_LIT: {
+            const auto slot = static_cast<const IdentifierLiteral &>(node).getSlot();
+            auto it = std::find_if(m_vars.begin(), m_vars.end(), [&](const Var &v) { return v.slot == slot; });
+            if (it == m_vars.end())
+                it = m_vars.insert(m_vars.end(), Var{slot, 0, {}});
+            it->readers.push_back(index);
+            break;
+        }
+        default:
+            break;
+    }
+
+    return index;
+}
+
+RuntimeVar IncrementalExpr::eval(const EvalContext &ctx) {
+    const auto slots = ctx.values();
+    const auto versions = ctx.versions();
+
+    // A short context would read past its values, and its missing
+    // stamps would never invalidate anything
+    const auto slotCount = m_expr.program().slotCount();
+    if (slots.size() < slotCount || versions.size() < slotCount)
+        throw std::runtime_error(std::format("Expression reads variable slot {} but only {} values were given",
+                                             slotCount - 1, std::min(slots.size(), versions.size())));
+
+    for (auto &var: m_vars) {
+        if (versions[var.slot] != var.seen) {
+            var.seen = versions[var.slot];
+            for (const auto reader: var.readers)
+                invalidateUp(reader);
+        }
+    }
+
+    return evalNode(0, slots);
+}
+
+void IncrementalExpr::invalidateUp(std::size_t index) {
+    while (index != kNoParent && m_entries[index].valid) {
+        m_entries[index].valid = false;
+        index = m_entries[index].parent;
+    }
+}
+
+RuntimeVar IncrementalExpr::evalNode(const std::size_t index, const std::span<const RuntimeVar> slots) {
+    auto &entry = m_entries[index];
+    if (entry.valid) {
+        ++m_stats.reused;
+        return entry.memo;
+    }
+
+    entry.memo = compute(entry, slots);
+    entry.valid = true;
+    ++m_stats.evaluated;
+    return entry.memo;
+}
+
+// Children go through evalNode, so clean ones are served from their memo
+RuntimeVar IncrementalExpr::compute(const Entry &entry, const std::span<const RuntimeVar> slots) {
+    if (entry.node->type == NodeType::PROGRAM) {
+        RuntimeVar res;
+        for (const auto child: entry.body)
+            res = evalNode(child, slots);
+        return res;
+    }
+
+    return evalNodeWith(*entry.node, slots, [&](const std::size_t i) {
+        return evalNode(entry.children[i], slots);
+    });
+}
+
+void IncrementalExpr::invalidate() {
+    for (auto &entry: m_entries) {
+        entry.valid = false;
+        entry.memo = RuntimeVar{};
+    }
+}
+
+const IncrementalStats &IncrementalExpr::stats() const {
+    return m_stats;
+}
+
+const CompiledExpr &IncrementalExpr::expr() const {
+    return m_expr;
+}
@@ -5,17 +5,113 @@
 Interpreter::Interpreter() = default;
 
 RuntimeVar Interpreter::eval(const std::string &input) {
-    parser.parse(input);
-    return parser.root().eval(m_vars);
+    if (m_cache.capacity() != 0) {
+        if (const auto *expr = m_cache.find(input))
+            return expr->eval(m_context);
+
+        return m_cache.insert(compile(input)).eval(m_context);
+    }
+
+    parser.parse(input, m_symbols);
+
+    if (m_engine == Engine::BYTECODE)
+        return m_context.vm().run(BytecodeCompiler::compile(parser.root()), m_context.values());
+
+    // Generating native code for a single uncached evaluation does not
+    // pay off, so Engine::JIT uses the tree walker here
+    return parser.root().eval(m_context.values());
+}
+
+CompiledExpr Interpreter::compile(const std::string &input, const OptimizerOptions &options) {
+    auto program = parser.compile(input, m_symbols);
+    const auto stats = Optimizer{options}.run(*program);
+    return CompiledExpr{input, std::move(program), m_engine, stats};
+}
+
+CompiledExpr Interpreter::compile(const std::string &input, const Schema &schema, const OptimizerOptions &options) {
+    auto program = parser.compile(input, m_symbols);
+
+    // Check the program as written: `simplify` may rewrite an ill-typed
+    // `name * 1` into plain `name`. The optimized program is inferred
+    // again for code generation.
+    TypeChecker types{schema};
+    types.check(*program);
+    const auto stats = Optimizer{options}.run(*program);
+    types.check(*program);
+    return CompiledExpr{input, std::move(program), types, stats};
+}
+
+RuntimeVar Interpreter::eval(const CompiledExpr &expr) {
+    return expr.eval(m_context);
+}
+
+RuntimeVar Interpreter::eval(IncrementalExpr &expr) {
+    return expr.eval(m_context);
+}
+
+EvalContext Interpreter::makeContext() const {
+    return EvalContext{m_context.values()};
 }
 
 void Interpreter::addVar(const std::string &ident, RuntimeVar val) {
-    m_vars[ident] = std::move(val);
+    m_context.set(m_symbols.declare(ident), std::move(val));
 }
 
 RuntimeVar Interpreter::getVar(const std::string &ident) {
-    if(!m_vars.contains(ident))
+    return getVar(slotOf(ident));
+}
+
+std::size_t Interpreter::slotOf(const std::string &ident) const {
+    const auto slot = m_symbols.lookup(ident);
+    if (!slot)
         throw std::runtime_error(std::format("Undeclared variable `{}` not found!", ident));
 
-    return m_vars[ident];
+    return *slot;
+}
+
+void Interpreter::setVar(const std::size_t slot, RuntimeVar val) {
+    if (slot >= m_context.values().size())
+        throw std::out_of_range(std::format("No variable in slot {}", slot));
+
+    m_context.set(slot, std::move(val));
+}
+
+const RuntimeVar &Interpreter::getVar(const std::size_t slot) const {
+    return m_context.get(slot);
+}
+
+const SymbolTable &Interpreter::symbols() const {
+    return m_symbols;
+}
+
+std::span<const RuntimeVar> Interpreter::values() const {
+    return m_context.values();
+}
+
+std::span<const std::uint64_t> Interpreter::versions() const {
+    return m_context.versions();
+}
+
+void Interpreter::setEngine(const Engine engine) {
+    // Cached expressions keep the engine they were compiled for
+    if (engine != m_engine)
+        m_cache.clear();
+
+    m_engine = engine;
+}
+
+Engine Interpreter::engine() const {
+    return m_engine;
+}
+
+void Interpreter::setCacheCapacity(const std::size_t capacity) {
+    m_cache.setCapacity(capacity);
+}
+
+const ExprCache &Interpreter::cache() const {
+    return m_cache;
+}
+
+void Interpreter::clearCache() {
+    m_cache.clear();
 }
@@ -0,0 +1,304 @@
+#include "../../include/expr-eval/backend/jit.h"
+#include "../../include/expr-eval/backend/trace.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// ----- JIT CODE ----- //
+JitCode::JitCode(void *page, const std::size_t pageSize, const std::size_t codeSize,
+                 std::vector<std::size_t> slots, const bool resultIsBool)
+    : m_page(page),
+      m_pageSize(pageSize),
+      m_codeSize(codeSize),
+      m_fn(reinterpret_cast<Fn>(page)),
+      m_slots(std::move(slots)),
+      m_resultIsBool(resultIsBool) {
+}
+
+JitCode::~JitCode() {
+#if defined(__x86_64__) && !defined(_WIN32)
+    munmap(m_page, m_pageSize);
+#endif
+}
+
+std::optional<RuntimeVar> JitCode::eval(const std::span<const RuntimeVar> slots) const {
+    TRACE_SCOPE("JitCode::eval");
+    for (const auto slot: m_slots) {
+        if (slot >= slots.size() || slots[slot].type != RuntimeVar::RuntimeVarType::NUMBER)
+            return std::nullopt;
+    }
+
+    const double res = m_fn(slots.data());
+
+    // Comparisons leave an all-ones (NaN) or all-zero mask behind
+    if (m_resultIsBool)
+        return RuntimeVar{std::bit_cast<std::uint64_t>(res) != 0};
+
+    return RuntimeVar{res};
+}
+
+std::size_t JitCode::codeSize() const {
+    return m_codeSize;
+}
+
+// ----- CODE GENERATION ----- //
+#if defined(__x86_64__) && !defined(_WIN32)
+
+namespace {
+    // SSE2 scalar-double encodings; `dst` and `src` are xmm register numbers
+    class Emitter {
+    public:
+        static constexpr int kRegisters = 16;
+
+        std::vector<std::uint8_t> code;
+
+        // movsd xmm, [rdi + disp]
+        void load(const int dst, const std::int32_t disp) {
+            byte(0xF2);
+            rex(false, dst, 0);
+            byte(0x0F);
+            byte(0x10);
+            byte(0x80 | (dst & 7) << 3 | 7); // mod=10, rm=rdi
+            imm(static_cast<std::uint32_t>(disp), 4);
+        }
+
+        // mov rax, imm64; movq xmm, rax
+        void constant(const int dst, const std::uint64_t bits) {
+            byte(0x48);
+            byte(0xB8);
+            imm(bits, 8);
+            byte(0x66);
+            rex(true, dst, 0);
+            byte(0x0F);
+            byte(0x6E);
+            byte(0xC0 | (dst & 7) << 3);
+        }
+
+        // Scalar-double arithmetic and cmpsd (F2 prefix)
+        void sd(const std::uint8_t op, const int dst, const int src) { rr(0xF2, op, dst, src); }
+
+        // Packed-double bitwise ops and moves (66 prefix)
+        void pd(const std::uint8_t op, const int dst, const int src) { rr(0x66, op, dst, src); }
+
+        void cmp(const int dst, const int src, const std::uint8_t predicate) {
+            sd(0xC2, dst, src);
+            byte(predicate);
+        }
+
+        void ret() { byte(0xC3); }
+
+    private:
+        void byte(const std::uint8_t b) { code.push_back(b); }
+
+        void imm(std::uint64_t v, const int bytes) {
+            for (int i = 0; i < bytes; ++i, v >>= 8) byte(static_cast<std::uint8_t>(v));
+        }
+
+        void rex(const bool w, const int reg, const int rm) {
+            const std::uint8_t r = 0x40 | (w ? 8 : 0) | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0);
+            if (r != 0x40) byte(r);
+        }
+
+        void rr(const std::uint8_t prefix, const std::uint8_t op, const int dst, const int src) {
+            byte(prefix);
+            rex(false, dst, src);
+            byte(0x0F);
+            byte(op);
+            byte(0xC0 | (dst & 7) << 3 | (src & 7));
+        }
+    };
+
+    constexpr std::uint8_t ADDSD = 0x58, MULSD = 0x59, SUBSD = 0x5C, DIVSD = 0x5E;
+    constexpr std::uint8_t MOVAPD = 0x28, ANDPD = 0x54, ANDNPD = 0x55, ORPD = 0x56, XORPD = 0x57;
+    constexpr std::uint8_t CMP_EQ = 0, CMP_LT = 1, CMP_LE = 2, CMP_NEQ = 4;
+
+    enum class Kind { NUMBER, BOOL };
+
+    // Evaluates `node` into xmm`reg`, using only higher registers as
+    // temporaries. Returns nullopt for anything unsupported.
+    class Lowering {
+    public:
+        Emitter out;
+        std::vector<std::size_t> slots;
+
+        std::optional<Kind> lower(const Node &node, const int reg) {
+            if (reg + 2 >= Emitter::kRegisters)
+                return std::nullopt;
+
+            switch (node.type) {
+                case NodeType::NUMBER_LIT:
+                    out.constant(reg, std::bit_cast<std::uint64_t>(static_cast<const NumberLiteral &>(node).getValue()));
+                    return Kind::NUMBER;
+                case NodeType::BOOLEAN_LIT:
+                    out.constant(reg, static_cast<const BooleanLiteral &>(node).getValue() ? ~0ull : 0ull);
+                    return Kind::BOOL;
+                case NodeType::IDENT_LIT:
+                    return loadSlot(static_cast<const IdentifierLiteral &>(node).getSlot(), reg);
+                case NodeType::BINARY_EXPR:
+                    return lowerBinary(static_cast<const BinaryExpr &>(node), reg);
+                case NodeType::CONDITIONAL_EXPR:
+                    return lowerConditional(static_cast<const ConditionalExpr &>(node), reg);
+                default:
+                    return std::nullopt;
+            }
+        }
+
+    private:
+        std::optional<Kind> loadSlot(const std::size_t slot, const int reg) {
+            const RuntimeVar probe;
+            const auto valueOffset = reinterpret_cast<const char *>(&probe.d_value) - reinterpret_cast<const char *>(&probe);
+            const auto disp = slot * sizeof(RuntimeVar) + valueOffset;
+            if (disp > INT32_MAX)
+                return std::nullopt;
+
+            if (std::find(slots.begin(), slots.end(), slot) == slots.end())
+                slots.push_back(slot);
+
+            out.load(reg, static_cast<std::int32_t>(disp));
+            return Kind::NUMBER;
+        }
+
+        // Turn a number into a truthiness mask, matching RuntimeVar::toBool
+        void toMask(const int reg) {
+            out.pd(XORPD, reg + 1, reg + 1);
+            out.cmp(reg, reg + 1, CMP_NEQ);
+        }
+
+        // Sethi-Ullman number: registers needed to evaluate `node`
+        static int registersNeeded(const Node &node) {
+            if (node.type == NodeType::CONDITIONAL_EXPR) {
+                const auto &cond = static_cast<const ConditionalExpr &>(node);
+                return std::max({registersNeeded(cond.getCondition()),
+                                 registersNeeded(cond.getThen()) + 1,
+                                 registersNeeded(cond.getElse()) + 2});
+            }
+
+            if (node.type != NodeType::BINARY_EXPR)
+                return 1;
+
+            const auto &bin = static_cast<const BinaryExpr &>(node);
+            const int l = registersNeeded(bin.getLeft());
+            const int r = registersNeeded(bin.getRight());
+            return l == r ? l + 1 : std::max(l, r);
+        }
+
+        // Both branches are computed and blended through the condition
+        // mask. Once the slot guard has passed neither branch can raise,
+        // so skipping the lazy evaluation does not change the result.
+        std::optional<Kind> lowerConditional(const ConditionalExpr &cond, const int reg) {
+            const auto ck = lower(cond.getCondition(), reg);
+            if (!ck) return std::nullopt;
+            if (*ck == Kind::NUMBER) toMask(reg);
+
+            const auto tk = lower(cond.getThen(), reg + 1);
+            if (!tk) return std::nullopt;
+            const auto ek = lower(cond.getElse(), reg + 2);
+            if (!ek || *ek != *tk) return std::nullopt;
+
+            out.pd(ANDPD, reg + 1, reg); // then & mask
+            out.pd(ANDNPD, reg, reg + 2); // else & ~mask
+            out.pd(ORPD, reg, reg + 1);
+            return tk;
+        }
+
+        std::optional<Kind> lowerBinary(const BinaryExpr &bin, const int reg) {
+            const auto op = bin.getOp();
+            const bool logical = op == BinaryOp::AND || op == BinaryOp::OR;
+
+            // Evaluate the hungrier operand first so it can use the low
+            // registers; operands have no side effects, so order is free
+            const bool rightFirst = registersNeeded(bin.getRight()) > registersNeeded(bin.getLeft());
+            const int lreg = rightFirst ? reg + 1 : reg;
+            const int rreg = rightFirst ? reg : reg + 1;
+
+            std::optional<Kind> lk, rk;
+            for (const bool right: {rightFirst, !rightFirst}) {
+                const int r = right ? rreg : lreg;
+                auto &kind = right ? rk : lk;
+
+                kind = lower(right ? bin.getRight() : bin.getLeft(), r);
+                if (!kind) return std::nullopt;
+                if (logical && *kind == Kind::NUMBER) toMask(r);
+            }
+
+            auto result = Kind::BOOL;
+            int dst = lreg;
+
+            if (logical) {
+                out.pd(op == BinaryOp::AND ? ANDPD : ORPD, lreg, rreg);
+            } else if (*lk != Kind::NUMBER || *rk != Kind::NUMBER) {
+                // Everything else needs two numbers; bool equality is left
+                // to the interpreter
+                return std::nullopt;
+            } else {
+                switch (op) {
+                    case BinaryOp::ADD: out.sd(ADDSD, lreg, rreg); result = Kind::NUMBER; break;
+                    case BinaryOp::SUB: out.sd(SUBSD, lreg, rreg); result = Kind::NUMBER; break;
+                    case BinaryOp::MUL: out.sd(MULSD, lreg, rreg); result = Kind::NUMBER; break;
+                    case BinaryOp::DIV: out.sd(DIVSD, lreg, rreg); result = Kind::NUMBER; break;
+                    case BinaryOp::EQ: out.cmp(lreg, rreg, CMP_EQ); break;
+                    case BinaryOp::NEQ: out.cmp(lreg, rreg, CMP_NEQ); break;
+                    case BinaryOp::LT: out.cmp(lreg, rreg, CMP_LT); break;
+                    case BinaryOp::LT_EQ: out.cmp(lreg, rreg, CMP_LE); break;
+                    case BinaryOp::GT:
+                    case BinaryOp::GT_EQ:
+                        // a > b is b < a; the ordered predicates keep NaN false
+                        out.cmp(rreg, lreg, op == BinaryOp::GT ? CMP_LT : CMP_LE);
+                        dst = rreg;
+                        break;
+                    default: // `%` has no SSE2 instruction
+                        return std::nullopt;
+                }
+            }
+
+            if (dst != reg)
+                out.pd(MOVAPD, reg, dst);
+            return result;
+        }
+    };
+}
+
+std::shared_ptr<const JitCode> JitCompiler::compile(const Program &program) {
+    TRACE_SCOPE("JitCompiler::compile");
+    // Earlier expressions could raise, so only single expressions qualify
+    const auto &nodes = program.getNodes();
+    if (nodes.size() != 1)
+        return nullptr;
+
+    Lowering lowering;
+    const auto kind = lowering.lower(*nodes.front(), 0);
+    if (!kind)
+        return nullptr;
+    lowering.out.ret();
+
+    const auto &code = lowering.out.code;
+    const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const auto size = (code.size() + pageSize - 1) / pageSize * pageSize;
+
+    void *page = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED)
+        return nullptr;
+
+    std::memcpy(page, code.data(), code.size());
+    if (mprotect(page, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(page, size);
+        return nullptr;
+    }
+
+    return std::shared_ptr<const JitCode>(
+        new JitCode(page, size, code.size(), std::move(lowering.slots), *kind == Kind::BOOL));
+}
+
+#else
+
+std::shared_ptr<const JitCode> JitCompiler::compile(const Program &) {
+    return nullptr;
+}
+
+#endif
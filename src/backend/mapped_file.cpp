@@ -0,0 +1,132 @@
+#include "../../include/expr-eval/backend/mapped_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <format>
+#include <utility>
+
+#if defined(_WIN32)
+#include <fstream>
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &path) {
+#if defined(_WIN32)
+    std::ifstream in{path, std::ios::binary};
+    if (!in)
+        throw std::runtime_error(std::format("Cannot open `{}`", path));
+
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    m_owned = std::move(buffer).str();
+    m_data = m_owned.data();
+    m_size = m_owned.size();
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error(std::format("Cannot open `{}`: {}", path, std::strerror(errno)));
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        const int err = errno;
+        ::close(fd);
+        throw std::runtime_error(std::format("Cannot stat `{}`: {}", path, std::strerror(err)));
+    }
+
+    // Only regular files report their real size; a pipe would map as empty
+    if (!S_ISREG(st.st_mode)) {
+        ::close(fd);
+        throw std::runtime_error(std::format("Cannot map `{}`: not a regular file", path));
+    }
+
+    // mmap rejects empty mappings; an empty file is just an empty view
+    if (st.st_size > 0) {
+        void *data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            const int err = errno;
+            ::close(fd);
+            throw std::runtime_error(std::format("Cannot map `{}`: {}", path, std::strerror(err)));
+        }
+
+        // Input is consumed front to back; let the kernel read ahead
+        ::madvise(data, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+        m_data = static_cast<const char *>(data);
+        m_size = static_cast<std::size_t>(st.st_size);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+#endif
+}
+
+bool MappedFile::mappable(const std::string &path) {
+    std::error_code ec;
+    return std::filesystem::is_regular_file(path, ec);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)),
+      m_size(std::exchange(other.m_size, 0)),
+      m_owned(std::move(other.m_owned)) {
+    if (!m_owned.empty())
+        m_data = m_owned.data();
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        release();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_owned = std::move(other.m_owned);
+        if (!m_owned.empty())
+            m_data = m_owned.data();
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+std::string_view MappedFile::view() const {
+    return {m_data, m_size};
+}
+
+std::size_t MappedFile::size() const {
+    return m_size;
+}
+
+void MappedFile::evict(std::size_t begin, std::size_t end) const {
+#if !defined(_WIN32)
+    if (!m_owned.empty() || m_data == nullptr)
+        return;
+
+    // Only whole pages inside the range; the mapping itself is page aligned
+    static const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    begin = (begin + pageSize - 1) / pageSize * pageSize;
+    end = std::min(end, m_size) / pageSize * pageSize;
+    if (begin < end)
+        ::madvise(const_cast<char *>(m_data) + begin, end - begin, MADV_DONTNEED);
+#else
+    (void) begin;
+    (void) end;
+#endif
+}
+
+void MappedFile::release() {
+#if !defined(_WIN32)
+    if (m_data != nullptr && m_owned.empty())
+        ::munmap(const_cast<char *>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_owned.clear();
+}
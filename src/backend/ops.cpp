@@ -0,0 +1,138 @@
+#include "../../include/expr-eval/backend/ops.h"
+
+#include <array>
+#include <cmath>
+#include <functional>
+#include <string>
+
+using Type = RuntimeVar::RuntimeVarType;
+
+static constexpr std::size_t idx(const Type t) {
+    return static_cast<std::size_t>(t);
+}
+
+// Falls back to the RuntimeVar operator, which also produces the type
+// error messages for unsupported pairs.
+template<BinaryOp Op>
+static RuntimeVar generic(const RuntimeVar &l, const RuntimeVar &r) {
+    if constexpr (Op == BinaryOp::ADD) return l + r;
+    else if constexpr (Op == BinaryOp::SUB) return l - r;
+    else if constexpr (Op == BinaryOp::MUL) return l * r;
+    else if constexpr (Op == BinaryOp::DIV) return l / r;
+    else if constexpr (Op == BinaryOp::MOD) return l % r;
+    else if constexpr (Op == BinaryOp::OR) return l || r;
+    else if constexpr (Op == BinaryOp::AND) return l && r;
+    else if constexpr (Op == BinaryOp::EQ) return l == r;
+    else if constexpr (Op == BinaryOp::NEQ) return l != r;
+    else if constexpr (Op == BinaryOp::LT) return l < r;
+    else if constexpr (Op == BinaryOp::LT_EQ) return l <= r;
+    else if constexpr (Op == BinaryOp::GT) return l > r;
+    else return l >= r;
+}
+
+struct Fmod {
+    double operator()(const double a, const double b) const { return std::fmod(a, b); }
+};
+
+template<typename F>
+static RuntimeVar numbers(const RuntimeVar &l, const RuntimeVar &r) {
+    return RuntimeVar{F{}(l.d_value, r.d_value)};
+}
+
+template<typename F>
+static RuntimeVar strings(const RuntimeVar &l, const RuntimeVar &r) {
+    return RuntimeVar{F{}(l.s_value->str(), r.s_value->str())};
+}
+
+template<typename F>
+static RuntimeVar bools(const RuntimeVar &l, const RuntimeVar &r) {
+    return RuntimeVar{F{}(l.b_value, r.b_value)};
+}
+
+static RuntimeVar concat(const RuntimeVar &l, const RuntimeVar &r) {
+    return RuntimeVar::concat(l, r);
+}
+
+template<BinaryOp Op>
+static constexpr BinaryKernels genericKernels() {
+    BinaryKernels k{};
+    for (auto &row: k.fn)
+        for (auto &cell: row)
+            cell = &generic<Op>;
+    return k;
+}
+
+static constexpr std::array<BinaryKernels, kBinaryOpCount> buildKernels() {
+    std::array<BinaryKernels, kBinaryOpCount> table{
+        genericKernels<BinaryOp::ADD>(),
+        genericKernels<BinaryOp::SUB>(),
+        genericKernels<BinaryOp::MUL>(),
+        genericKernels<BinaryOp::DIV>(),
+        genericKernels<BinaryOp::MOD>(),
+        genericKernels<BinaryOp::OR>(),
+        genericKernels<BinaryOp::AND>(),
+        genericKernels<BinaryOp::EQ>(),
+        genericKernels<BinaryOp::NEQ>(),
+        genericKernels<BinaryOp::LT>(),
+        genericKernels<BinaryOp::LT_EQ>(),
+        genericKernels<BinaryOp::GT>(),
+        genericKernels<BinaryOp::GT_EQ>(),
+    };
+
+    auto cell = [&table](BinaryOp op, Type l, Type r) -> BinaryFn & {
+        return table[static_cast<std::size_t>(op)].fn[idx(l)][idx(r)];
+    };
+
+    constexpr auto N = Type::NUMBER, S = Type::STRING, B = Type::BOOL;
+
+    cell(BinaryOp::ADD, N, N) = &numbers<std::plus<> >;
+    cell(BinaryOp::ADD, S, S) = &concat;
+    cell(BinaryOp::SUB, N, N) = &numbers<std::minus<> >;
+    cell(BinaryOp::MUL, N, N) = &numbers<std::multiplies<> >;
+    cell(BinaryOp::DIV, N, N) = &numbers<std::divides<> >;
+    cell(BinaryOp::MOD, N, N) = &numbers<Fmod>;
+
+    cell(BinaryOp::EQ, N, N) = &numbers<std::equal_to<> >;
+    cell(BinaryOp::EQ, S, S) = &strings<std::equal_to<> >;
+    cell(BinaryOp::EQ, B, B) = &bools<std::equal_to<> >;
+    cell(BinaryOp::NEQ, N, N) = &numbers<std::not_equal_to<> >;
+    cell(BinaryOp::NEQ, S, S) = &strings<std::not_equal_to<> >;
+    cell(BinaryOp::NEQ, B, B) = &bools<std::not_equal_to<> >;
+
+    cell(BinaryOp::LT, N, N) = &numbers<std::less<> >;
+    cell(BinaryOp::LT, S, S) = &strings<std::less<> >;
+    cell(BinaryOp::LT_EQ, N, N) = &numbers<std::less_equal<> >;
+    cell(BinaryOp::LT_EQ, S, S) = &strings<std::less_equal<> >;
+    cell(BinaryOp::GT, N, N) = &numbers<std::greater<> >;
+    cell(BinaryOp::GT, S, S) = &strings<std::greater<> >;
+    cell(BinaryOp::GT_EQ, N, N) = &numbers<std::greater_equal<> >;
+    cell(BinaryOp::GT_EQ, S, S) = &strings<std::greater_equal<> >;
+
+    return table;
+}
+
+// Built at compile time, so the table is ready before any static initializer runs
+static constexpr std::array<BinaryKernels, kBinaryOpCount> kKernels = buildKernels();
+
+const BinaryKernels &binaryKernels(const BinaryOp op) {
+    return kKernels[static_cast<std::size_t>(op)];
+}
+
+std::string_view binaryOpStr(const BinaryOp op) {
+    switch (op) {
+        case BinaryOp::ADD: return "+";
+        case BinaryOp::SUB: return "-";
+        case BinaryOp::MUL: return "*";
+        case BinaryOp::DIV: return "/";
+        case BinaryOp::MOD: return "%";
+        case BinaryOp::OR: return "||";
+        case BinaryOp::AND: return "&&";
+        case BinaryOp::EQ: return "==";
+        case BinaryOp::NEQ: return "!=";
+        case BinaryOp::LT: return "<";
+        case BinaryOp::LT_EQ: return "<=";
+        case BinaryOp::GT: return ">";
+        case BinaryOp::GT_EQ: return ">=";
+        default: return "?";
+    }
+}
@@ -0,0 +1,165 @@
+#include "../../include/expr-eval/backend/profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <format>
+#include <string>
+
+Profiler::Profiler(const Program &program) {
+    add(program);
+}
+
+// Number the nodes depth-first; an entry knows its children by index,
+// so evaluation never has to look a node up
+std::size_t Profiler::add(const Node &node) {
+    const auto index = m_entries.size();
+    m_entries.push_back(Entry{&node, {}, 0, {}, {}});
+
+    std::size_t children[3];
+    std::size_t count = 0;
+    switch (node.type) {
+        case NodeType::PROGRAM:
+            for (const auto *stmt: static_cast<const Program &>(node).getNodes()) {
+                const auto child = add(*stmt);
+                m_entries[index].body.push_back(child);
+            }
+            break;
+        case NodeType::BINARY_EXPR: {
+            const auto &bin = static_cast<const BinaryExpr &>(node);
+            children[count++] = add(bin.getLeft());
+            children[count++] = add(bin.getRight());
+            break;
+        }
+        case NodeType::CONDITIONAL_EXPR: {
+            const auto &cond = static_cast<const ConditionalExpr &>(node);
+            children[count++] = add(cond.getCondition());
+            children[count++] = add(cond.getThen());
+            children[count++] = add(cond.getElse());
+            break;
+        }
+        default:
+            break;
+    }
+
+    auto &entry = m_entries[index];
+    std::copy_n(children, count, entry.children);
+    entry.childCount = count;
+    return index;
+}
+
+RuntimeVar Profiler::eval(const std::span<const RuntimeVar> slots) {
+    const auto slotCount = static_cast<const Program *>(m_entries[0].node)->slotCount();
+    if (slots.size() < slotCount)
+        throw std::runtime_error(std::format("Expression reads variable slot {} but only {} values were given",
+                                             slotCount - 1, slots.size()));
+
+    std::uint64_t ns = 0;
+    return evalNode(0, slots, ns);
+}
+
+RuntimeVar Profiler::evalNode(const std::size_t index, const std::span<const RuntimeVar> slots,
+                              std::uint64_t &parentNs) {
+    auto &entry = m_entries[index];
+    std::uint64_t childNs = 0;
+    const auto start = Clock::now();
+
+    auto finish = [&] {
+        const auto ns = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        ++entry.stats.evals;
+        entry.stats.totalNs += ns;
+        entry.stats.selfNs += ns - std::min(childNs, ns);
+        parentNs += ns;
+    };
+
+    try {
+        auto res = apply(entry, slots, childNs);
+        finish();
+        ++entry.stats.results[static_cast<std::size_t>(res.type)];
+        return res;
+    } catch (...) {
+        finish();
+        ++entry.stats.errors;
+        throw;
+    }
+}
+
+// Children go through evalNode so they are timed too
+RuntimeVar Profiler::apply(const Entry &entry, const std::span<const RuntimeVar> slots, std::uint64_t &childNs) {
+    if (entry.node->type == NodeType::PROGRAM) {
+        RuntimeVar res;
+        for (const auto child: entry.body)
+            res = evalNode(child, slots, childNs);
+        return res;
+    }
+
+    return evalNodeWith(*entry.node, slots, [&](const std::size_t i) {
+        return evalNode(entry.children[i], slots, childNs);
+    });
+}
+
+void Profiler::reset() {
+    for (auto &entry: m_entries)
+        entry.stats = {};
+}
+
+const NodeProfile &Profiler::profile(const Node &node) const {
+    const auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                                 [&](const Entry &entry) { return entry.node == &node; });
+    if (it == m_entries.end())
+        throw std::out_of_range("Node is not part of the profiled program");
+
+    return it->stats;
+}
+
+picojson::value Profiler::dump() const {
+    auto res = m_entries.front().node->dump();
+    annotate(0, res);
+    return res;
+}
+
+// Walk the dump alongside the entries, using the keys each node's dump()
+// stores its children under
+void Profiler::annotate(const std::size_t index, picojson::value &dump) const {
+    static constexpr const char *binaryKeys[] = {"left", "right"};
+    static constexpr const char *conditionalKeys[] = {"cond", "then", "else"};
+    static constexpr const char *typeNames[kRuntimeVarTypeCount] = {"string", "number", "nil", "bool"}; // as typeStr()
+
+    const auto &entry = m_entries[index];
+    const auto &stats = entry.stats;
+    auto &obj = dump.get<picojson::object>();
+
+    picojson::object results;
+    for (std::size_t type = 0; type < kRuntimeVarTypeCount; ++type) {
+        if (stats.results[type] != 0)
+            results[typeNames[type]] = picojson::value(static_cast<double>(stats.results[type]));
+    }
+
+    picojson::object profile;
+    profile["evals"] = picojson::value(static_cast<double>(stats.evals));
+    profile["total_ns"] = picojson::value(static_cast<double>(stats.totalNs));
+    profile["self_ns"] = picojson::value(static_cast<double>(stats.selfNs));
+    profile["avg_ns"] = picojson::value(stats.evals ? static_cast<double>(stats.totalNs) / static_cast<double>(stats.evals) : 0.0);
+    profile["results"] = picojson::value(results);
+    profile["errors"] = picojson::value(static_cast<double>(stats.errors));
+    obj["profile"] = picojson::value(profile);
+
+    switch (entry.node->type) {
+        case NodeType::PROGRAM: {
+            auto &body = obj["body"].get<picojson::array>();
+            for (std::size_t i = 0; i < entry.body.size(); ++i)
+                annotate(entry.body[i], body[i]);
+            break;
+        }
+        case NodeType::BINARY_EXPR:
+            for (std::size_t i = 0; i < entry.childCount; ++i)
+                annotate(entry.children[i], obj[binaryKeys[i]]);
+            break;
+        case NodeType::CONDITIONAL_EXPR:
+            for (std::size_t i = 0; i < entry.childCount; ++i)
+                annotate(entry.children[i], obj[conditionalKeys[i]]);
+            break;
+        default:
+            break;
+    }
+}
@@ -1,30 +1,198 @@
 #include "../../include/expr-eval/backend/runtime.h"
 #include <cmath>
 #include <cstddef>
+#include <mutex>
 #include <stdexcept>
+#include <utility>
+#include <vector>
+
+// ----- STRING VALUE ----- //
+StringValue::StringValue(std::string s)
+    : m_size(s.size()),
+      m_flat(true),
+      m_str(std::move(s)) {
+}
+
+StringValue::StringValue(StringValue *left, StringValue *right)
+    : m_size(left->m_size + right->m_size),
+      m_flat(false),
+      m_left(left),
+      m_right(right) {
+    left->refs.fetch_add(1, std::memory_order_relaxed);
+    right->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+StringValue *StringValue::concat(StringValue *left, StringValue *right) {
+    if (left->m_size + right->m_size >= kRopeThreshold)
+        return new StringValue(left, right);
+
+    std::string res;
+    res.reserve(left->m_size + right->m_size);
+    res.append(left->str()).append(right->str());
+    return new StringValue(std::move(res));
+}
+
+void StringValue::release(StringValue *value) {
+    if (value->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
 
+    if (!value->m_left) {
+        delete value;
+        return;
+    }
+
+    // Long chains are deep, so rope children are freed from a worklist
+    std::vector<StringValue *> pending{value->m_left, value->m_right};
+    delete value;
+
+    while (!pending.empty()) {
+        auto *v = pending.back();
+        pending.pop_back();
+
+        if (v->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            continue;
+
+        if (v->m_left) {
+            pending.push_back(v->m_left);
+            pending.push_back(v->m_right);
+        }
+        delete v;
+    }
+}
+
+std::size_t StringValue::size() const {
+    return m_size;
+}
+
+const std::string &StringValue::str() const {
+    if (!m_flat.load(std::memory_order_acquire))
+        flatten();
+
+    return m_str;
+}
+
+bool StringValue::isRope() const {
+    return !m_flat.load(std::memory_order_acquire);
+}
+
+void StringValue::append(const std::string_view text) {
+    m_str.append(text);
+    m_size = m_str.size();
+}
+
+void StringValue::flatten() const {
+    // Flattening happens once per rope, so one lock for all of them is enough
+    static std::mutex mutex;
+    std::lock_guard lock{mutex};
+    if (m_flat.load(std::memory_order_relaxed))
+        return;
+
+    std::string res;
+    res.reserve(m_size);
+
+    // In-order walk; flat children (and already flattened ropes) are leaves
+    std::vector<const StringValue *> stack{m_right, m_left};
+    while (!stack.empty()) {
+        const auto *v = stack.back();
+        stack.pop_back();
+
+        if (v->m_flat.load(std::memory_order_relaxed)) {
+            res.append(v->m_str);
+        } else {
+            stack.push_back(v->m_right);
+            stack.push_back(v->m_left);
+        }
+    }
+
+    m_str = std::move(res);
+    m_flat.store(true, std::memory_order_release);
+
+    // The children are no longer needed once the text exists
+    release(m_left);
+    release(m_right);
+    m_left = m_right = nullptr;
+}
+
+// ----- RUNTIME VAR ----- //
 RuntimeVar::RuntimeVar()
     : type(RuntimeVarType::NIL),
-      value("nil") {
+      d_value(0.0) {
 }
 
 RuntimeVar::RuntimeVar(std::string v)
     : type(RuntimeVarType::STRING),
-      value(std::move(v)) {
+      s_value(new StringValue(std::move(v))) {
+}
+
+RuntimeVar::RuntimeVar(StringValue *s)
+    : type(RuntimeVarType::STRING),
+      s_value(s) {
 }
 
 RuntimeVar::RuntimeVar(const bool t)
     : type(RuntimeVarType::BOOL),
-      value(t ? "true" : "false"),
       b_value(t) {
 }
 
 RuntimeVar::RuntimeVar(const double d)
     : type(RuntimeVarType::NUMBER),
-      value(std::format("{}", d)),
       d_value(d) {
 }
 
+RuntimeVar::RuntimeVar(const RuntimeVar &other)
+    : type(RuntimeVarType::NIL) {
+    assign(other);
+    retain();
+}
+
+RuntimeVar::RuntimeVar(RuntimeVar &&other) noexcept
+    : type(RuntimeVarType::NIL) {
+    assign(other);
+    other.type = RuntimeVarType::NIL; // ownership of s_value moved
+}
+
+RuntimeVar &RuntimeVar::operator=(const RuntimeVar &other) {
+    if (this != &other) {
+        other.retain();
+        release();
+        assign(other);
+    }
+    return *this;
+}
+
+RuntimeVar &RuntimeVar::operator=(RuntimeVar &&other) noexcept {
+    if (this != &other) {
+        release();
+        assign(other);
+        other.type = RuntimeVarType::NIL;
+    }
+    return *this;
+}
+
+RuntimeVar::~RuntimeVar() {
+    release();
+}
+
+void RuntimeVar::assign(const RuntimeVar &other) {
+    type = other.type;
+    switch (type) {
+        case RuntimeVarType::STRING: s_value = other.s_value; break;
+        case RuntimeVarType::NUMBER: d_value = other.d_value; break;
+        case RuntimeVarType::BOOL: b_value = other.b_value; break;
+        default: break;
+    }
+}
+
+void RuntimeVar::retain() const {
+    if (type == RuntimeVarType::STRING)
+        s_value->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RuntimeVar::release() const {
+    if (type == RuntimeVarType::STRING)
+        StringValue::release(s_value);
+}
+
 std::string RuntimeVar::typeStr() const {
     switch (type) {
         case RuntimeVarType::STRING:
@@ -41,160 +209,168 @@ std::string RuntimeVar::typeStr() const {
 
 double RuntimeVar::toDouble() const {
     if (type == RuntimeVarType::NUMBER)
-        return stod(value);
+        return d_value;
 
     throw std::runtime_error("Expected number type");
 }
 
 std::string RuntimeVar::toString() const {
-    return value;
+    switch (type) {
+        case RuntimeVarType::STRING:
+            return s_value->str();
+        case RuntimeVarType::NUMBER:
+            return std::format("{}", d_value);
+        case RuntimeVarType::BOOL:
+            return b_value ? "true" : "false";
+        default:
+            return "nil";
+    }
 }
 
 bool RuntimeVar::toBool() const {
-    if (value == "false" || value == "nil") return false;
-    if (type == RuntimeVarType::NUMBER) return toDouble() != 0.0f;
-    return true;
+    switch (type) {
+        case RuntimeVarType::NUMBER:
+            return d_value != 0.0;
+        case RuntimeVarType::BOOL:
+            return b_value;
+        case RuntimeVarType::STRING:
+            // Only "false" and "nil" are falsy; other lengths need no text
+            if (s_value->size() != 5 && s_value->size() != 3) return true;
+            return s_value->str() != "false" && s_value->str() != "nil";
+        default:
+            return false;
+    }
 }
 
-RuntimeVar RuntimeVar::operator+(const RuntimeVar &other) const {
+const std::string &RuntimeVar::str() const {
+    if (type != RuntimeVarType::STRING)
+        throw std::runtime_error("Expected string type");
+
+    return s_value->str();
+}
+
+RuntimeVar RuntimeVar::concat(const RuntimeVar &l, const RuntimeVar &r) {
+    return RuntimeVar{StringValue::concat(l.s_value, r.s_value)};
+}
+
+void RuntimeVar::append(RuntimeVar &l, const RuntimeVar &r) {
+    if (l.s_value->refs.load(std::memory_order_acquire) == 1 && !l.s_value->isRope()) {
+        l.s_value->append(r.s_value->str());
+        return;
+    }
+
+    l = concat(l, r);
+}
+
+void RuntimeVar::checkSameType(const char *op, const RuntimeVar &other) const {
     if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '+' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+        throw std::runtime_error(std::format("Expected same types to op '{}' but found {} and {}.",
+                                             op, typeStr(), other.typeStr()));
+}
+
+RuntimeVar RuntimeVar::operator+(const RuntimeVar &other) const {
+    checkSameType("+", other);
 
     if (type == RuntimeVarType::STRING) {
-        return RuntimeVar{value + other.value};
+        return concat(*this, other);
     }
 
     if (type == RuntimeVarType::NUMBER) {
-        const auto res = toDouble() + other.toDouble();
-        return RuntimeVar{res};
+        return RuntimeVar{d_value + other.d_value};
     }
 
     throw std::runtime_error(std::format("Op '+' not supported for type {}", typeStr()));
 }
 
 RuntimeVar RuntimeVar::operator-(const RuntimeVar &other) const {
-    if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '-' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+    checkSameType("-", other);
 
     if (type == RuntimeVarType::NUMBER) {
-        const auto res = toDouble() - other.toDouble();
-        return RuntimeVar{res};
+        return RuntimeVar{d_value - other.d_value};
     }
 
-    throw std::runtime_error(std::format("Op '+' not supported for type {}", typeStr()));
+    throw std::runtime_error(std::format("Op '-' not supported for type {}", typeStr()));
 }
 
 RuntimeVar RuntimeVar::operator*(const RuntimeVar &other) const {
-    if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '*' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+    checkSameType("*", other);
 
     if (type == RuntimeVarType::NUMBER) {
-        const auto res = toDouble() * other.toDouble();
-        return RuntimeVar{res};
+        return RuntimeVar{d_value * other.d_value};
     }
 
-    throw std::runtime_error(std::format("Op '+' not supported for type {}", typeStr()));
+    throw std::runtime_error(std::format("Op '*' not supported for type {}", typeStr()));
 }
 
 RuntimeVar RuntimeVar::operator/(const RuntimeVar &other) const {
-    if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '/' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+    checkSameType("/", other);
 
     if (type == RuntimeVarType::NUMBER) {
-        const auto res = toDouble() / other.toDouble();
-        return RuntimeVar{res};
+        return RuntimeVar{d_value / other.d_value};
     }
 
-    throw std::runtime_error(std::format("Op '+' not supported for type {}", typeStr()));
+    throw std::runtime_error(std::format("Op '/' not supported for type {}", typeStr()));
 }
 
 RuntimeVar RuntimeVar::operator%(const RuntimeVar& other) const {
-    if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '%' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+    checkSameType("%", other);
 
     if (type == RuntimeVarType::NUMBER) {
-        const auto res = std::fmod(toDouble(), other.toDouble()); //
-        return RuntimeVar{res};
+        return RuntimeVar{std::fmod(d_value, other.d_value)};
     }
 
     throw std::runtime_error(std::format("Op '%' not supported for type {}", typeStr()));
 }
 
 RuntimeVar RuntimeVar::operator==(const RuntimeVar& other) const {
-    if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '==' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+    checkSameType("==", other);
 
-    const auto res = value == other.value;
-    return RuntimeVar{res};
+    switch (type) {
+        case RuntimeVarType::NUMBER: return RuntimeVar{d_value == other.d_value};
+        case RuntimeVarType::BOOL: return RuntimeVar{b_value == other.b_value};
+        case RuntimeVarType::STRING: return RuntimeVar{s_value->str() == other.s_value->str()};
+        default: return RuntimeVar{true};
+    }
 }
 
 RuntimeVar RuntimeVar::operator!=(const RuntimeVar& other) const {
-    if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '!=' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+    checkSameType("!=", other);
 
-    const auto res = value != other.value;
-    return RuntimeVar{res};
+    return RuntimeVar{!(*this == other).b_value};
 }
 
 RuntimeVar RuntimeVar::operator>(const RuntimeVar& other) const {
-    if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '>' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+    checkSameType(">", other);
 
-    // TODO ...
-    if (type == RuntimeVarType::NUMBER || type == RuntimeVarType::STRING) {
-        const auto res = value > other.value;
-        return RuntimeVar{res};
-    }
+    if (type == RuntimeVarType::NUMBER) return RuntimeVar{d_value > other.d_value};
+    if (type == RuntimeVarType::STRING) return RuntimeVar{s_value->str() > other.s_value->str()};
 
     throw std::runtime_error(std::format("Op '>' not supported for type {}", typeStr()));
 }
 
 RuntimeVar RuntimeVar::operator>=(const RuntimeVar& other) const {
-    if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '>=' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+    checkSameType(">=", other);
 
-    // TODO ...
-    if (type == RuntimeVarType::NUMBER || type == RuntimeVarType::STRING) {
-        const auto res = value >= other.value;
-        return RuntimeVar{res};
-    }
+    if (type == RuntimeVarType::NUMBER) return RuntimeVar{d_value >= other.d_value};
+    if (type == RuntimeVarType::STRING) return RuntimeVar{s_value->str() >= other.s_value->str()};
 
     throw std::runtime_error(std::format("Op '>=' not supported for type {}", typeStr()));
 }
 
 RuntimeVar RuntimeVar::operator<(const RuntimeVar& other) const {
-    if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '<' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+    checkSameType("<", other);
 
-    // TODO ...
-    if (type == RuntimeVarType::NUMBER || type == RuntimeVarType::STRING) {
-        const auto res = value < other.value;
-        return RuntimeVar{res};
-    }
+    if (type == RuntimeVarType::NUMBER) return RuntimeVar{d_value < other.d_value};
+    if (type == RuntimeVarType::STRING) return RuntimeVar{s_value->str() < other.s_value->str()};
 
     throw std::runtime_error(std::format("Op '<' not supported for type {}", typeStr()));
 }
 
 RuntimeVar RuntimeVar::operator<=(const RuntimeVar& other) const {
-    if (type != other.type)
-        throw std::runtime_error(std::format("Expected same types to op '<=' but found {} and {}.",
-                                             typeStr(), other.typeStr()));
+    checkSameType("<=", other);
 
-    // TODO ...
-    if (type == RuntimeVarType::NUMBER || type == RuntimeVarType::STRING) {
-        const auto res = value <= other.value;
-        return RuntimeVar{res};
-    }
+    if (type == RuntimeVarType::NUMBER) return RuntimeVar{d_value <= other.d_value};
+    if (type == RuntimeVarType::STRING) return RuntimeVar{s_value->str() <= other.s_value->str()};
 
     throw std::runtime_error(std::format("Op '<=' not supported for type {}", typeStr()));
 }
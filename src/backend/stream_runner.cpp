@@ -0,0 +1,416 @@
+#include "../../include/expr-eval/backend/stream_runner.h"
+#include "../../include/expr-eval/backend/bounded_queue.h"
+#include "../../include/expr-eval/backend/bytecode.h"
+#include "../../include/expr-eval/backend/vm.h"
+#include "../../include/expr-eval/backend/trace.h"
+#include "../../include/expr-eval/frontend/parser.h"
+#include "../../include/expr-eval/frontend/optimizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(const Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static bool isBlank(const std::string_view line) {
+    return std::all_of(line.begin(), line.end(), [](const unsigned char c) { return std::isspace(c); });
+}
+
+// ----- STAGE PAYLOADS ----- //
+struct LineBatch {
+    std::size_t firstLine; // 1-based number of lines[0]
+    std::vector<std::string> lines;
+};
+
+struct ParsedLine {
+    std::size_t line;
+    std::optional<CompiledExpr> expr; // unset if parsing failed
+    std::string error;
+};
+
+using ParsedBatch = std::vector<ParsedLine>;
+
+// A newline-aligned slice of in-memory input and what became of it
+struct InputChunk {
+    std::string_view text;
+    std::size_t firstLine;
+    std::string output;
+    std::size_t expressions = 0, errors = 0;
+    double parseSeconds = 0.0, evalSeconds = 0.0;
+};
+
+// Reused by every chunk a pool worker runs, so lines are parsed into the
+// same arena and evaluated with the same VM stack
+struct ChunkWorker {
+    explicit ChunkWorker(const std::span<const RuntimeVar> values) : context(values) {}
+
+    Parser parser;
+    EvalContext context;
+};
+
+// ----- NDJSON OUTPUT ----- //
+// Formats result objects into a growing string; callers decide when to
+// hand it to the FILE, so nothing is written per line.
+class NdjsonBuffer {
+public:
+    void value(const std::size_t line, const RuntimeVar &value) {
+        begin(line);
+        m_buf += ",\"value\":";
+        switch (value.type) {
+            case RuntimeVar::RuntimeVarType::NUMBER: appendNumber(value.d_value); break;
+            case RuntimeVar::RuntimeVarType::STRING: appendString(value.str()); break;
+            case RuntimeVar::RuntimeVarType::BOOL: m_buf += value.b_value ? "true" : "false"; break;
+            default: m_buf += "null"; break;
+        }
+        m_buf += "}\n";
+    }
+
+    void error(const std::size_t line, const std::string_view message) {
+        begin(line);
+        m_buf += ",\"error\":";
+        appendString(message);
+        m_buf += "}\n";
+    }
+
+    std::string &str() {
+        return m_buf;
+    }
+
+private:
+    void begin(const std::size_t line) {
+        m_buf += "{\"line\":";
+        char tmp[24];
+        const auto res = std::to_chars(tmp, tmp + sizeof tmp, line);
+        m_buf.append(tmp, res.ptr);
+    }
+
+    void appendNumber(const double d) {
+        // JSON has no literals for these
+        if (std::isnan(d)) {
+            m_buf += "\"nan\"";
+        } else if (std::isinf(d)) {
+            m_buf += d < 0 ? "\"-inf\"" : "\"inf\"";
+        } else {
+            char tmp[32];
+            const auto res = std::to_chars(tmp, tmp + sizeof tmp, d);
+            m_buf.append(tmp, res.ptr);
+        }
+    }
+
+    void appendString(const std::string_view s) {
+        static constexpr char hex[] = "0123456789abcdef";
+
+        m_buf += '"';
+        for (const char c: s) {
+            switch (c) {
+                case '"': m_buf += "\\\""; break;
+                case '\\': m_buf += "\\\\"; break;
+                case '\n': m_buf += "\\n"; break;
+                case '\r': m_buf += "\\r"; break;
+                case '\t': m_buf += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        m_buf += "\\u00";
+                        m_buf += hex[c >> 4];
+                        m_buf += hex[c & 0xF];
+                    } else {
+                        m_buf += c;
+                    }
+            }
+        }
+        m_buf += '"';
+    }
+
+    std::string m_buf;
+};
+
+// Write and clear `buf`, adding its size to `written`
+static void writeOut(std::FILE *out, std::string &buf, std::uint64_t &written) {
+    if (buf.empty())
+        return;
+
+    if (std::fwrite(buf.data(), 1, buf.size(), out) != buf.size())
+        throw std::runtime_error("Failed to write results");
+
+    written += buf.size();
+    buf.clear();
+}
+
+// ----- STREAM STATS ----- //
+void StreamStats::print(std::FILE *out) const {
+    const auto rate = seconds > 0.0 ? static_cast<double>(expressions) / seconds : 0.0;
+    const auto mib = seconds > 0.0 ? static_cast<double>(bytesIn) / (1 << 20) / seconds : 0.0;
+
+    std::fprintf(out, "%zu expressions (%zu errors) from %zu lines in %.3f s: %.0f expr/s, %.1f MiB/s in, "
+                 "%llu bytes out; stage busy time: parse %.3f s, eval %.3f s\n",
+                 expressions, errors, lines, seconds, rate, mib,
+                 static_cast<unsigned long long>(bytesOut), parseSeconds, evalSeconds);
+}
+
+// ----- STREAM RUNNER ----- //
+StreamRunner::StreamRunner(const SymbolTable &symbols, EvalContext context, const StreamOptions options)
+    : m_symbols(symbols),
+      m_context(std::move(context)),
+      m_options(options) {
+}
+
+StreamStats StreamRunner::run(std::istream &in, std::FILE *out) {
+    const auto start = Clock::now();
+    const auto engine = m_options.engine == Engine::JIT ? Engine::TREE_WALKER : m_options.engine;
+    const auto batchLines = std::max<std::size_t>(m_options.batchLines, 1);
+
+    StreamStats stats;
+    BoundedQueue<LineBatch> lines{m_options.queueDepth};
+    BoundedQueue<ParsedBatch> parsed{m_options.queueDepth};
+
+    // A failing stage closes its queues so the others wind down too; the
+    // error is rethrown once every thread has been joined
+    std::exception_ptr parseError, evalError;
+
+    std::thread parseStage([&] {
+        try {
+            Parser parser;
+            const Optimizer optimizer;
+
+            while (auto batch = lines.pop()) {
+                TRACE_SCOPE("StreamRunner::parseBatch");
+                const auto busy = Clock::now();
+
+                ParsedBatch items;
+                items.reserve(batch->lines.size());
+                for (std::size_t i = 0; i < batch->lines.size(); ++i) {
+                    auto &src = batch->lines[i];
+                    if (isBlank(src))
+                        continue;
+
+                    const auto line = batch->firstLine + i;
+                    try {
+                        auto program = parser.compile(src, m_symbols);
+                        const auto optimized = optimizer.run(*program);
+                        items.push_back(ParsedLine{line, CompiledExpr{std::move(src), std::move(program), engine, optimized}, {}});
+                    } catch (const std::exception &e) {
+                        items.push_back(ParsedLine{line, std::nullopt, e.what()});
+                    }
+                }
+
+                stats.parseSeconds += secondsSince(busy);
+                if (!parsed.push(std::move(items)))
+                    break;
+            }
+        } catch (...) {
+            parseError = std::current_exception();
+            lines.close();
+        }
+        parsed.close();
+    });
+
+    std::thread evalStage([&] {
+        try {
+            NdjsonBuffer writer;
+            writer.str().reserve(m_options.outputBuffer + 256);
+
+            while (auto batch = parsed.pop()) {
+                TRACE_SCOPE("StreamRunner::evalBatch");
+                const auto busy = Clock::now();
+
+                for (const auto &item: *batch) {
+                    ++stats.expressions;
+                    if (!item.expr) {
+                        ++stats.errors;
+                        writer.error(item.line, item.error);
+                    } else {
+                        try {
+                            writer.value(item.line, item.expr->eval(m_context));
+                        } catch (const std::exception &e) {
+                            ++stats.errors;
+                            writer.error(item.line, e.what());
+                        }
+                    }
+
+                    if (writer.str().size() >= m_options.outputBuffer)
+                        writeOut(out, writer.str(), stats.bytesOut);
+                }
+
+                stats.evalSeconds += secondsSince(busy);
+            }
+
+            writeOut(out, writer.str(), stats.bytesOut);
+            if (std::fflush(out) != 0)
+                throw std::runtime_error("Failed to write results");
+        } catch (...) {
+            evalError = std::current_exception();
+            parsed.close();
+            lines.close();
+        }
+    });
+
+    // The calling thread reads; lines are moved, not copied, downstream
+    LineBatch batch{1, {}};
+    batch.lines.reserve(batchLines);
+
+    std::string line;
+    while (std::getline(in, line)) {
+        ++stats.lines;
+        stats.bytesIn += line.size() + 1;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        batch.lines.push_back(std::move(line));
+        if (batch.lines.size() == batchLines) {
+            const auto next = batch.firstLine + batch.lines.size();
+            if (!lines.push(std::move(batch)))
+                break;
+
+            batch = LineBatch{next, {}};
+            batch.lines.reserve(batchLines);
+        }
+    }
+
+    if (!batch.lines.empty())
+        lines.push(std::move(batch));
+    lines.close();
+
+    parseStage.join();
+    evalStage.join();
+
+    if (parseError) std::rethrow_exception(parseError);
+    if (evalError) std::rethrow_exception(evalError);
+
+    stats.seconds = secondsSince(start);
+    return stats;
+}
+
+// Evaluate every line of `chunk`, leaving NDJSON in chunk.output
+static void runChunk(InputChunk &chunk, ChunkWorker &worker, const SymbolTable &symbols, const Engine engine) {
+    TRACE_SCOPE("StreamRunner::chunk");
+    NdjsonBuffer writer;
+    writer.str().swap(chunk.output);
+    writer.str().clear();
+
+    auto rest = chunk.text;
+    for (auto line = chunk.firstLine; !rest.empty(); ++line) {
+        const auto nl = rest.find('\n');
+        auto text = rest.substr(0, nl);
+        rest.remove_prefix(nl == std::string_view::npos ? rest.size() : nl + 1);
+
+        if (!text.empty() && text.back() == '\r')
+            text.remove_suffix(1);
+        if (isBlank(text))
+            continue;
+
+        ++chunk.expressions;
+        const auto parseStart = Clock::now();
+        try {
+            worker.parser.parse(text, symbols);
+        } catch (const std::exception &e) {
+            chunk.parseSeconds += secondsSince(parseStart);
+            ++chunk.errors;
+            writer.error(line, e.what());
+            continue;
+        }
+
+        const auto evalStart = Clock::now();
+        chunk.parseSeconds += std::chrono::duration<double>(evalStart - parseStart).count();
+        try {
+            auto &program = worker.parser.root();
+            const auto &values = worker.context.values();
+            writer.value(line, engine == Engine::BYTECODE
+                                   ? worker.context.vm().run(BytecodeCompiler::compile(program), values)
+                                   : program.eval(values));
+        } catch (const std::exception &e) {
+            ++chunk.errors;
+            writer.error(line, e.what());
+        }
+        chunk.evalSeconds += secondsSince(evalStart);
+    }
+
+    chunk.output.swap(writer.str());
+}
+
+StreamStats StreamRunner::run(const std::string_view input, std::FILE *out, ThreadPool &pool) {
+    return runChunks(input, out, pool, nullptr);
+}
+
+StreamStats StreamRunner::run(const MappedFile &input, std::FILE *out, ThreadPool &pool) {
+    return runChunks(input.view(), out, pool, &input);
+}
+
+StreamStats StreamRunner::runChunks(const std::string_view input, std::FILE *out, ThreadPool &pool,
+                                    const MappedFile *file) {
+    const auto start = Clock::now();
+    const auto engine = m_options.engine == Engine::JIT ? Engine::TREE_WALKER : m_options.engine;
+    const auto chunkBytes = std::max<std::size_t>(m_options.chunkBytes, 1);
+
+    StreamStats stats;
+    stats.bytesIn = input.size();
+
+    std::vector<std::unique_ptr<ChunkWorker> > workers;
+    workers.reserve(pool.size());
+    for (std::size_t i = 0; i < pool.size(); ++i)
+        workers.push_back(std::make_unique<ChunkWorker>(m_context.values()));
+
+    // The input is handled in waves of a few chunks per worker, so only
+    // one wave of output is ever held in memory
+    std::vector<InputChunk> wave(std::max<std::size_t>(pool.size(), 1) * 4);
+    std::size_t pos = 0, nextLine = 1;
+
+    while (pos < input.size()) {
+        const auto waveStart = pos;
+        std::size_t count = 0;
+        for (; count < wave.size() && pos < input.size(); ++count) {
+            // Extend each cut to the end of the line it falls in
+            auto end = std::min(pos + chunkBytes, input.size());
+            const auto nl = input.find('\n', end - 1);
+            end = nl == std::string_view::npos ? input.size() : nl + 1;
+
+            auto &chunk = wave[count];
+            chunk.text = input.substr(pos, end - pos);
+            chunk.firstLine = nextLine;
+            chunk.expressions = chunk.errors = 0;
+            chunk.parseSeconds = chunk.evalSeconds = 0.0;
+
+            // Every chunk but possibly the last ends in a newline
+            const auto lines = static_cast<std::size_t>(std::count(chunk.text.begin(), chunk.text.end(), '\n'));
+            nextLine += lines + (chunk.text.back() == '\n' ? 0 : 1);
+            pos = end;
+        }
+
+        pool.parallelFor(count, [&](const std::size_t i, const std::size_t worker) {
+            runChunk(wave[i], *workers[worker], m_symbols, engine);
+        });
+
+        for (std::size_t i = 0; i < count; ++i) {
+            auto &chunk = wave[i];
+            stats.expressions += chunk.expressions;
+            stats.errors += chunk.errors;
+            stats.parseSeconds += chunk.parseSeconds;
+            stats.evalSeconds += chunk.evalSeconds;
+            writeOut(out, chunk.output, stats.bytesOut);
+        }
+
+        if (file != nullptr)
+            file->evict(waveStart, pos);
+    }
+
+    if (std::fflush(out) != 0)
+        throw std::runtime_error("Failed to write results");
+
+    stats.lines = nextLine - 1;
+    stats.seconds = secondsSince(start);
+    return stats;
+}
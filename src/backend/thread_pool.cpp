@@ -0,0 +1,114 @@
+#include "../../include/expr-eval/backend/thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+#include <latch>
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    threads = std::max<std::size_t>(threads, 1);
+
+    for (std::size_t i = 0; i < threads; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+
+    for (std::size_t i = 0; i < threads; ++i)
+        m_threads.emplace_back([this, i] { run(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+
+    for (auto &t: m_threads)
+        t.join();
+}
+
+std::size_t ThreadPool::size() const {
+    return m_workers.size();
+}
+
+void ThreadPool::submit(Task task) {
+    const auto target = m_next.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+    {
+        // Counted before the task is published, so a worker that takes it
+        // right away cannot decrement m_queued below zero. Done under
+        // m_mutex so a worker about to sleep cannot miss it.
+        std::lock_guard lock(m_mutex);
+        m_queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard lock(m_workers[target]->mutex);
+        m_workers[target]->tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void ThreadPool::parallelFor(const std::size_t count,
+                             const std::function<void(std::size_t i, std::size_t worker)> &fn) {
+    if (count == 0)
+        return;
+
+    std::latch done(static_cast<std::ptrdiff_t>(count));
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        submit([&, i](const std::size_t worker) {
+            try {
+                fn(i, worker);
+            } catch (...) {
+                std::lock_guard lock(errorMutex);
+                if (!error) error = std::current_exception();
+            }
+            done.count_down();
+        });
+    }
+
+    done.wait();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void ThreadPool::run(const std::size_t id) {
+    for (;;) {
+        Task task;
+        if (pop(id, task) || steal(id, task)) {
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            task(id);
+            continue;
+        }
+
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_stop || m_queued.load(std::memory_order_relaxed) > 0; });
+        if (m_stop && m_queued.load(std::memory_order_relaxed) == 0)
+            return;
+    }
+}
+
+bool ThreadPool::pop(const std::size_t id, Task &task) {
+    auto &worker = *m_workers[id];
+    std::lock_guard lock(worker.mutex);
+    if (worker.tasks.empty())
+        return false;
+
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(const std::size_t id, Task &task) {
+    for (std::size_t i = 1; i < m_workers.size(); ++i) {
+        auto &victim = *m_workers[(id + i) % m_workers.size()];
+        std::lock_guard lock(victim.mutex);
+        if (victim.tasks.empty())
+            continue;
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,198 @@
+#include "../../include/expr-eval/backend/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <format>
+#include <vector>
+
+struct TraceEvent {
+    const char *name;
+    std::uint64_t start;
+    std::uint64_t end;
+};
+
+// One thread's ring. Only the owning thread writes events and `head`;
+// readers take `head` with acquire to see the events before it.
+struct TraceBuffer {
+    explicit TraceBuffer(const std::uint32_t tid) : tid(tid), events(Tracer::kBufferCapacity) {}
+
+    std::uint32_t tid;
+    std::vector<TraceEvent> events;
+    std::atomic<std::uint64_t> head{0}; // spans recorded since the last clear()
+    bool exited = false; // owning thread has finished; guarded by registryMutex()
+};
+
+// Rings outlive their threads so spans of finished threads are still
+// exported, but only until then: a finished thread's ring is dropped
+// once write() has exported it or clear() has discarded it, or at once
+// if it holds no spans. Registration is the only locked step on the
+// recording side, once per thread.
+static std::mutex &registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::vector<std::shared_ptr<TraceBuffer> > &registry() {
+    static std::vector<std::shared_ptr<TraceBuffer> > buffers;
+    return buffers;
+}
+
+// Drop the finished threads' rings in `done`; the caller holds registryMutex()
+static void dropExited(const std::vector<std::shared_ptr<TraceBuffer> > &done) {
+    std::erase_if(registry(), [&](const auto &buffer) {
+        return std::find(done.begin(), done.end(), buffer) != done.end();
+    });
+}
+
+// The calling thread's ring, registered on first use and retired when
+// the thread exits
+class ThreadRing {
+public:
+    ThreadRing() {
+        static std::uint32_t nextTid = 1;
+
+        std::lock_guard lock{registryMutex()};
+        m_buffer = registry().emplace_back(std::make_shared<TraceBuffer>(nextTid++));
+    }
+
+    ThreadRing(const ThreadRing &) = delete;
+
+    ThreadRing &operator=(const ThreadRing &) = delete;
+
+    ~ThreadRing() {
+        std::lock_guard lock{registryMutex()};
+        m_buffer->exited = true;
+        if (m_buffer->head.load(std::memory_order_relaxed) == 0)
+            dropExited({m_buffer});
+    }
+
+    TraceBuffer &buffer() const {
+        return *m_buffer;
+    }
+
+private:
+    std::shared_ptr<TraceBuffer> m_buffer;
+};
+
+static TraceBuffer &threadBuffer() {
+    thread_local const ThreadRing ring;
+    return ring.buffer();
+}
+
+static std::chrono::steady_clock::time_point epoch() {
+    static const auto start = std::chrono::steady_clock::now();
+    return start;
+}
+
+void Tracer::enable() {
+    epoch(); // fix the clock's zero before the first span
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::disable() {
+    s_enabled.store(false, std::memory_order_relaxed);
+}
+
+std::uint64_t Tracer::now() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch()).count());
+}
+
+void Tracer::record(const char *name, const std::uint64_t startNs, const std::uint64_t endNs) {
+    auto &buffer = threadBuffer();
+    const auto head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % kBufferCapacity] = TraceEvent{name, startNs, endNs};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+// Export every ring; the caller holds registryMutex()
+static picojson::value dumpLocked() {
+    constexpr auto kBufferCapacity = Tracer::kBufferCapacity;
+    picojson::array events;
+    double dropped = 0;
+
+    for (const auto &buffer: registry()) {
+        const auto head = buffer->head.load(std::memory_order_acquire);
+        if (head == 0)
+            continue;
+
+        const auto tid = picojson::value(static_cast<double>(buffer->tid));
+
+        // Name the track in the viewer
+        picojson::object args;
+        args["name"] = picojson::value(std::format("thread {}", buffer->tid));
+        picojson::object meta;
+        meta["name"] = picojson::value("thread_name");
+        meta["ph"] = picojson::value("M");
+        meta["pid"] = picojson::value(1.0);
+        meta["tid"] = tid;
+        meta["args"] = picojson::value(args);
+        events.emplace_back(meta);
+
+        const auto first = head > kBufferCapacity ? head - kBufferCapacity : 0;
+        dropped += static_cast<double>(first);
+        for (auto i = first; i < head; ++i) {
+            const auto &event = buffer->events[i % kBufferCapacity];
+
+            // Complete events ("X") carry their own begin and duration, so
+            // a span whose neighbours were overwritten still stands alone
+            picojson::object obj;
+            obj["name"] = picojson::value(event.name);
+            obj["cat"] = picojson::value("expr-eval");
+            obj["ph"] = picojson::value("X");
+            obj["ts"] = picojson::value(static_cast<double>(event.start) / 1000.0);
+            obj["dur"] = picojson::value(static_cast<double>(event.end - event.start) / 1000.0);
+            obj["pid"] = picojson::value(1.0);
+            obj["tid"] = tid;
+            events.emplace_back(obj);
+        }
+    }
+
+    picojson::object other;
+    other["dropped_spans"] = picojson::value(dropped);
+
+    picojson::object res;
+    res["traceEvents"] = picojson::value(events);
+    res["displayTimeUnit"] = picojson::value("ns");
+    res["otherData"] = picojson::value(other);
+    return picojson::value(res);
+}
+
+picojson::value Tracer::dump() {
+    std::lock_guard lock{registryMutex()};
+    return dumpLocked();
+}
+
+void Tracer::write(const std::string &path) {
+    picojson::value trace;
+    std::vector<std::shared_ptr<TraceBuffer> > exported; // rings of finished threads
+    {
+        std::lock_guard lock{registryMutex()};
+        trace = dumpLocked();
+        for (const auto &buffer: registry())
+            if (buffer->exited) exported.push_back(buffer);
+    }
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    file << trace.serialize();
+    if (!file.flush())
+        throw std::runtime_error(std::format("Cannot write trace `{}`", path));
+
+    // Their spans are on disk and no thread will add more
+    std::lock_guard lock{registryMutex()};
+    dropExited(exported);
+}
+
+void Tracer::clear() {
+    std::lock_guard lock{registryMutex()};
+    std::vector<std::shared_ptr<TraceBuffer> > exited;
+    for (const auto &buffer: registry()) {
+        buffer->head.store(0, std::memory_order_release);
+        if (buffer->exited) exited.push_back(buffer);
+    }
+    dropExited(exited);
+}
@@ -0,0 +1,139 @@
+#include "../../include/expr-eval/backend/vm.h"
+#include "../../include/expr-eval/backend/ops.h"
+#include "../../include/expr-eval/backend/eval_counters.h"
+#include "../../include/expr-eval/backend/trace.h"
+
+#include <cmath>
+
+RuntimeVar VM::run(const Chunk &chunk, const std::span<const RuntimeVar> slots) {
+    return run(ChunkView{chunk.code.data(), chunk.constants.data(), chunk.maxStack}, slots);
+}
+
+RuntimeVar VM::run(const ChunkView &chunk, const std::span<const RuntimeVar> slots) {
+    TRACE_SCOPE("VM::run");
+    if (m_stack.size() < chunk.maxStack)
+        m_stack.resize(chunk.maxStack);
+
+    RuntimeVar *stack = m_stack.data();
+    std::size_t sp = 0;
+
+    const Instr *code = chunk.code;
+    auto &counters = evalCounters();
+
+    for (const Instr *ip = code;; ++ip) {
+        switch (ip->op) {
+            case OpCode::PUSH_NUM:
+                stack[sp++] = RuntimeVar{ip->num};
+                break;
+            case OpCode::PUSH_CONST:
+                stack[sp++] = chunk.constants[ip->arg];
+                break;
+            case OpCode::PUSH_TRUE:
+                stack[sp++] = RuntimeVar{true};
+                break;
+            case OpCode::PUSH_FALSE:
+                stack[sp++] = RuntimeVar{false};
+                break;
+            case OpCode::PUSH_NIL:
+                stack[sp++] = RuntimeVar{};
+                break;
+            case OpCode::LOAD_VAR:
+                stack[sp++] = slots[ip->arg];
+                break;
+
+            case OpCode::BINARY:
+                --sp;
+                if (static_cast<BinaryOp>(ip->arg) == BinaryOp::ADD
+                    && stack[sp - 1].type == RuntimeVar::RuntimeVarType::STRING
+                    && stack[sp].type == RuntimeVar::RuntimeVarType::STRING) {
+                    RuntimeVar::append(stack[sp - 1], stack[sp]);
+                    break;
+                }
+                stack[sp - 1] = binaryKernels(static_cast<BinaryOp>(ip->arg))(stack[sp - 1], stack[sp]);
+                break;
+
+            // Operands are numbers, so the result can be written in place
+            case OpCode::ADD_NUM:
+                --sp;
+                stack[sp - 1].d_value += stack[sp].d_value;
+                break;
+            case OpCode::SUB_NUM:
+                --sp;
+                stack[sp - 1].d_value -= stack[sp].d_value;
+                break;
+            case OpCode::MUL_NUM:
+                --sp;
+                stack[sp - 1].d_value *= stack[sp].d_value;
+                break;
+            case OpCode::DIV_NUM:
+                --sp;
+                stack[sp - 1].d_value /= stack[sp].d_value;
+                break;
+            case OpCode::MOD_NUM:
+                --sp;
+                stack[sp - 1].d_value = std::fmod(stack[sp - 1].d_value, stack[sp].d_value);
+                break;
+            case OpCode::EQ_NUM:
+                --sp;
+                stack[sp - 1] = RuntimeVar{stack[sp - 1].d_value == stack[sp].d_value};
+                break;
+            case OpCode::NEQ_NUM:
+                --sp;
+                stack[sp - 1] = RuntimeVar{stack[sp - 1].d_value != stack[sp].d_value};
+                break;
+            case OpCode::LT_NUM:
+                --sp;
+                stack[sp - 1] = RuntimeVar{stack[sp - 1].d_value < stack[sp].d_value};
+                break;
+            case OpCode::LT_EQ_NUM:
+                --sp;
+                stack[sp - 1] = RuntimeVar{stack[sp - 1].d_value <= stack[sp].d_value};
+                break;
+            case OpCode::GT_NUM:
+                --sp;
+                stack[sp - 1] = RuntimeVar{stack[sp - 1].d_value > stack[sp].d_value};
+                break;
+            case OpCode::GT_EQ_NUM:
+                --sp;
+                stack[sp - 1] = RuntimeVar{stack[sp - 1].d_value >= stack[sp].d_value};
+                break;
+            case OpCode::CONCAT:
+                --sp;
+                RuntimeVar::append(stack[sp - 1], stack[sp]);
+                break;
+
+            // Jumps land one before their target because of the loop's ++ip
+            case OpCode::JUMP:
+                ip = code + ip->arg - 1;
+                break;
+            case OpCode::JUMP_IF_FALSE:
+                ++counters.branches;
+                ++counters.skipped;
+                if (!stack[--sp].toBool())
+                    ip = code + ip->arg - 1;
+                break;
+            case OpCode::JUMP_IF_FALSE_OR_POP:
+            case OpCode::JUMP_IF_TRUE_OR_POP: {
+                ++counters.branches;
+                const bool value = stack[sp - 1].toBool();
+                if (value == (ip->op == OpCode::JUMP_IF_TRUE_OR_POP)) {
+                    ++counters.skipped;
+                    stack[sp - 1] = RuntimeVar{value};
+                    ip = code + ip->arg - 1;
+                } else {
+                    --sp;
+                }
+                break;
+            }
+            case OpCode::TO_BOOL:
+                stack[sp - 1] = RuntimeVar{stack[sp - 1].toBool()};
+                break;
+
+            case OpCode::POP:
+                --sp;
+                break;
+            case OpCode::RETURN:
+                return std::move(stack[sp - 1]);
+        }
+    }
+}
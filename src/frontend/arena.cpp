@@ -0,0 +1,84 @@
+#include "../../include/expr-eval/frontend/arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+Arena::Arena(const std::size_t blockSize)
+    : m_blockSize(blockSize) {
+}
+
+Arena::~Arena() {
+    runFinalizers();
+}
+
+void *Arena::allocate(const std::size_t size, const std::size_t align) {
+    for (;;) {
+        if (m_current == m_blocks.size()) {
+            // Out of retained blocks; blocks come from operator new[] and
+            // are therefore suitably aligned for any node type
+            const auto blockSize = std::max(m_blockSize, size + align);
+            m_blocks.push_back(Block{std::make_unique<std::byte[]>(blockSize), blockSize});
+        }
+
+        auto &block = m_blocks[m_current];
+        const auto start = (m_offset + align - 1) & ~(align - 1);
+        if (start + size <= block.size) {
+            m_offset = start + size;
+            return block.data.get() + start;
+        }
+
+        // Move on to the next block, leaving the tail of this one unused
+        m_used += block.size;
+        ++m_current;
+        m_offset = 0;
+    }
+}
+
+std::string_view Arena::copy(const std::string_view str) {
+    if (str.empty())
+        return {};
+
+    auto *data = static_cast<char *>(allocate(str.size(), alignof(char)));
+    std::memcpy(data, str.data(), str.size());
+    return {data, str.size()};
+}
+
+void Arena::reset() {
+    runFinalizers();
+    m_current = 0;
+    m_offset = 0;
+    m_used = 0;
+    m_allocations = 0;
+}
+
+std::size_t Arena::allocations() const {
+    return m_allocations;
+}
+
+std::size_t Arena::blockAllocations() const {
+    return m_blocks.size();
+}
+
+std::size_t Arena::bytesUsed() const {
+    return m_used + m_offset;
+}
+
+std::size_t Arena::capacity() const {
+    std::size_t total = 0;
+    for (const auto &block: m_blocks)
+        total += block.size;
+    return total;
+}
+
+void Arena::addFinalizer(void *obj, void (*destroy)(void *)) {
+    auto *fin = static_cast<Finalizer *>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+    *fin = Finalizer{destroy, obj, m_finalizers};
+    m_finalizers = fin;
+}
+
+void Arena::runFinalizers() {
+    for (auto *fin = m_finalizers; fin; fin = fin->next)
+        fin->destroy(fin->obj);
+
+    m_finalizers = nullptr;
+}
@@ -1,21 +1,31 @@
 #include "../../include/expr-eval/frontend/ast.h"
+#include "../../include/expr-eval/backend/trace.h"
 
+#include <algorithm>
 #include <stdexcept>
-
-Node::Node(const NodeType t, std::string name)
-    : name(std::move(name)),
+#include <format>
+#include <type_traits>
+
+// Arena::reset() only stays O(1) while nodes need no destructor
+static_assert(std::is_trivially_destructible_v<BinaryExpr>);
+static_assert(std::is_trivially_destructible_v<ConditionalExpr>);
+static_assert(std::is_trivially_destructible_v<NumberLiteral>);
+static_assert(std::is_trivially_destructible_v<BooleanLiteral>);
+static_assert(std::is_trivially_destructible_v<IdentifierLiteral>);
+static_assert(std::is_trivially_destructible_v<NullLiteral>);
+
+Node::Node(const NodeType t, const std::string_view name)
+    : name(name),
       type(t) {
 }
 
-Node::~Node() = default;
-
-picojson::value Node::dump() {
+picojson::value Node::dump() const {
     picojson::object obj;
-    obj["name"] = picojson::value(name);
+    obj["name"] = picojson::value(std::string{name});
     return picojson::value(obj);
 }
 
-RuntimeVar Node::eval(std::unordered_map<std::string, RuntimeVar> &vars) {
+RuntimeVar Node::eval(std::span<const RuntimeVar>) const {
     return {};
 }
 
@@ -23,17 +33,54 @@ Program::Program()
     : Node(NodeType::PROGRAM, "Program") {
 }
 
-void Program::addNode(std::unique_ptr<Node> node) {
-    m_ast.push_back(std::move(node));
+// One past the highest identifier slot under `node`
+static std::size_t slotsUsed(const Node &node) {
+    switch (node.type) {
+        case NodeType::BINARY_EXPR: {
+            const auto &bin = static_cast<const BinaryExpr &>(node);
+            return std::max(slotsUsed(bin.getLeft()), slotsUsed(bin.getRight()));
+        }
+        case NodeType::CONDITIONAL_EXPR: {
+            const auto &cond = static_cast<const ConditionalExpr &>(node);
+            return std::max({slotsUsed(cond.getCondition()), slotsUsed(cond.getThen()), slotsUsed(cond.getElse())});
+        }
+        case NodeType::IDENT_LIT:
+            return static_cast<const IdentifierLiteral &>(node).getSlot() + 1;
+        default:
+            return 0;
+    }
+}
+
+void Program::addNode(Node *node) {
+    m_ast.push_back(node);
+    m_slotCount = std::max(m_slotCount, slotsUsed(*node));
 }
 
 void Program::clear() {
     m_ast.clear();
+    m_arena.reset();
+    m_slotCount = 0;
+}
+
+const std::vector<Node *> &Program::getNodes() const {
+    return m_ast;
+}
+
+std::size_t Program::slotCount() const {
+    return m_slotCount;
+}
+
+Arena &Program::arena() {
+    return m_arena;
 }
 
-picojson::value Program::dump() {
+const Arena &Program::arena() const {
+    return m_arena;
+}
+
+picojson::value Program::dump() const {
     picojson::object obj;
-    obj["name"] = picojson::value(name);
+    obj["name"] = picojson::value(std::string{name});
 
     picojson::array arr;
     for (const auto &e: m_ast) {
@@ -44,143 +91,188 @@ picojson::value Program::dump() {
     return picojson::value(obj);
 }
 
-RuntimeVar Program::eval(std::unordered_map<std::string, RuntimeVar> &vars) {
+RuntimeVar Program::eval(std::span<const RuntimeVar> slots) const {
+    TRACE_SCOPE("Program::eval");
+    // Identifiers read their slot unchecked, so the span is checked once here
+    if (slots.size() < m_slotCount)
+        throw std::runtime_error(std::format("Expression reads variable slot {} but only {} values were given",
+                                             m_slotCount - 1, slots.size()));
+
     RuntimeVar res;
 
     for (const auto &node: m_ast) {
-        res = node->eval(vars);
+        res = node->eval(slots);
     }
 
     return res;
 }
 
-Expr::Expr(const NodeType t, const std::string &name) : Node{t, name} {
+Expr::Expr(const NodeType t, const std::string_view name) : Node{t, name} {
 }
 
-BinaryExpr::BinaryExpr(std::unique_ptr<Node> left,
-                       std::string op, std::unique_ptr<Node> right)
+BinaryExpr::BinaryExpr(Node *left, const BinaryOp op, Node *right)
     : Expr(NodeType::BINARY_EXPR, "BinaryExpr"),
-      left(std::move(left)),
-      right(std::move(right)),
-      op(std::move(op)) {
+      left(left),
+      right(right),
+      op(op),
+      kernels(&binaryKernels(op)) {
+}
+
+const Node &BinaryExpr::getLeft() const {
+    return *left;
 }
 
-picojson::value BinaryExpr::dump() {
+const Node &BinaryExpr::getRight() const {
+    return *right;
+}
+
+BinaryOp BinaryExpr::getOp() const {
+    return op;
+}
+
+picojson::value BinaryExpr::dump() const {
     picojson::object obj;
-    obj["name"] = picojson::value(name);
+    obj["name"] = picojson::value(std::string{name});
     obj["left"] = left->dump();
-    obj["op"] = picojson::value(op);
+    obj["op"] = picojson::value(std::string{binaryOpStr(op)});
     obj["right"] = right->dump();
     return picojson::value(obj);
 }
 
-RuntimeVar BinaryExpr::eval(std::unordered_map<std::string, RuntimeVar> &vars) {
-    auto _l = left->eval(vars);
-    auto _r = right->eval(vars);
+RuntimeVar BinaryExpr::eval(std::span<const RuntimeVar> slots) const {
+    return evalBinary(op, *kernels, [&](const std::size_t i) { return (i == 0 ? left : right)->eval(slots); });
+}
 
-    if (op == "+") return _l + _r;
-    if (op == "-") return _l - _r;
-    if (op == "*") return _l * _r;
-    if (op == "/") return _l / _r;
-    if (op == "%") return _l % _r;
+ConditionalExpr::ConditionalExpr(Node *cond, Node *then, Node *otherwise)
+    : Expr(NodeType::CONDITIONAL_EXPR, "ConditionalExpr"),
+      cond(cond),
+      then(then),
+      otherwise(otherwise) {
+}
 
-    // ||, &&
-    if (op == "||") return _l || _r;
-    if (op == "&&") return _l && _r;
+const Node &ConditionalExpr::getCondition() const {
+    return *cond;
+}
 
-    // Equality
-    if (op == "==") return _l == _r;
-    if (op == "!=") return _l != _r;
+const Node &ConditionalExpr::getThen() const {
+    return *then;
+}
+
+const Node &ConditionalExpr::getElse() const {
+    return *otherwise;
+}
 
-    // Relational
-    if (op == ">") return _l > _r;
-    if (op == ">=") return _l >= _r;
-    if (op == "<") return _l < _r;
-    if (op == "<=") return _l <= _r;
+picojson::value ConditionalExpr::dump() const {
+    picojson::object obj;
+    obj["name"] = picojson::value(std::string{name});
+    obj["cond"] = cond->dump();
+    obj["then"] = then->dump();
+    obj["else"] = otherwise->dump();
+    return picojson::value(obj);
+}
 
-    throw std::runtime_error(std::format("Unimplemented op `{}`", op));
+RuntimeVar ConditionalExpr::eval(std::span<const RuntimeVar> slots) const {
+    const Node *children[] = {cond, then, otherwise};
+    return evalConditional([&](const std::size_t i) { return children[i]->eval(slots); });
 }
 
-NumberLiteral::NumberLiteral(const std::string &value)
+NumberLiteral::NumberLiteral(const double d)
     : Expr(NodeType::NUMBER_LIT, "NumberLiteral"),
-      value(value) {
-    d = stod(value);
+      d(d) {
+}
+
+double NumberLiteral::getValue() const {
+    return d;
 }
 
-picojson::value NumberLiteral::dump() {
+picojson::value NumberLiteral::dump() const {
     picojson::object obj;
-    obj["name"] = picojson::value(name);
+    obj["name"] = picojson::value(std::string{name});
     obj["value"] = picojson::value(d);
     return picojson::value(obj);
 }
 
-RuntimeVar NumberLiteral::eval(std::unordered_map<std::string, RuntimeVar> &vars) {
+RuntimeVar NumberLiteral::eval(std::span<const RuntimeVar>) const {
     return RuntimeVar{d};
 }
 
-BooleanLiteral::BooleanLiteral(const std::string &value)
+BooleanLiteral::BooleanLiteral(const bool value)
     : Expr(NodeType::BOOLEAN_LIT, "BooleanLiteral"),
-      value(value), b_value(value == "true") {
+      b_value(value) {
 }
 
-picojson::value BooleanLiteral::dump() {
+bool BooleanLiteral::getValue() const {
+    return b_value;
+}
+
+picojson::value BooleanLiteral::dump() const {
     picojson::object obj;
-    obj["name"] = picojson::value(name);
+    obj["name"] = picojson::value(std::string{name});
     obj["value"] = picojson::value(b_value);
     return picojson::value(obj);
 }
 
-RuntimeVar BooleanLiteral::eval(std::unordered_map<std::string, RuntimeVar> &vars) {
+RuntimeVar BooleanLiteral::eval(std::span<const RuntimeVar>) const {
     return RuntimeVar{b_value};
 }
 
-StringLiteral::StringLiteral(std::string value)
+StringLiteral::StringLiteral(const std::string_view value)
     : Expr(NodeType::STRING_LIT, "StringLiteral"),
-      value(std::move(value)) {
+      value(std::string{value}) {
 }
 
-picojson::value StringLiteral::dump() {
+const std::string &StringLiteral::getValue() const {
+    return value.str();
+}
+
+picojson::value StringLiteral::dump() const {
     picojson::object obj;
-    obj["name"] = picojson::value(name);
-    obj["value"] = picojson::value(value);
+    obj["name"] = picojson::value(std::string{name});
+    obj["value"] = picojson::value(value.str());
     return picojson::value(obj);
 }
 
-RuntimeVar StringLiteral::eval(std::unordered_map<std::string, RuntimeVar> &vars) {
-    return RuntimeVar{value};
+RuntimeVar StringLiteral::eval(std::span<const RuntimeVar>) const {
+    return value;
 }
 
-IdentifierLiteral::IdentifierLiteral(std::string value)
+IdentifierLiteral::IdentifierLiteral(const std::string_view value, const std::size_t slot)
     : Expr(NodeType::IDENT_LIT, "IdentifierLiteral"),
-      value(std::move(value)) {
+      value(value),
+      slot(slot) {
+}
+
+std::string_view IdentifierLiteral::getValue() const {
+    return value;
+}
+
+std::size_t IdentifierLiteral::getSlot() const {
+    return slot;
 }
 
-picojson::value IdentifierLiteral::dump() {
+picojson::value IdentifierLiteral::dump() const {
     picojson::object obj;
-    obj["name"] = picojson::value(name);
-    obj["value"] = picojson::value(value);
+    obj["name"] = picojson::value(std::string{name});
+    obj["value"] = picojson::value(std::string{value});
+    obj["slot"] = picojson::value(static_cast<double>(slot));
     return picojson::value(obj);
 }
 
-RuntimeVar IdentifierLiteral::eval(std::unordered_map<std::string, RuntimeVar> &vars) {
-    if (!vars.contains(value)) {
-        throw std::runtime_error(std::format("Use of undefined variable `{}`", value));
-    }
-
-    return vars[value];
+RuntimeVar IdentifierLiteral::eval(std::span<const RuntimeVar> slots) const {
+    return slots[slot];
 }
 
 NullLiteral::NullLiteral()
     : Expr(NodeType::NIL_LIT, "NullLiteral") {
 }
 
-picojson::value NullLiteral::dump() {
+picojson::value NullLiteral::dump() const {
     picojson::object obj;
-    obj["name"] = picojson::value(name);
-    obj["value"] = picojson::value(value);
+    obj["name"] = picojson::value(std::string{name});
+    obj["value"] = picojson::value("nil");
     return picojson::value(obj);
 }
 
-RuntimeVar NullLiteral::eval(std::unordered_map<std::string, RuntimeVar> &vars) {
+RuntimeVar NullLiteral::eval(std::span<const RuntimeVar>) const {
     return RuntimeVar{};
 }
@@ -1,20 +1,44 @@
 #include "../../include/expr-eval/frontend/lexer.h"
+#include "../../include/expr-eval/backend/trace.h"
 
 #include <cctype>
 #include <stdexcept>
 #include <format>
-#include <iostream>
 
-Token::Token(const TokenType _type, std::string _name, std::string _value)
-    : type(_type),
-      name(std::move(_name)),
-      value(std::move(_value)) {
+const char *tokenName(const TokenType type) {
+    switch (type) {
+        case TokenType::TOK_NUMBERS_LIT: return "TOK_NUMBERS_LIT";
+        case TokenType::TOK_STRING_LIT: return "TOK_STRING_LIT";
+        case TokenType::TOK_BOOL_LIT: return "TOK_BOOL_LIT";
+        case TokenType::TOK_NULL_LIT: return "TOK_NULL_LIT";
+        case TokenType::TOK_IDENT_LIT: return "TOK_IDENT_LIT";
+        case TokenType::TOK_ADD_OP: return "TOK_ADD_OP";
+        case TokenType::TOK_SUB_OP: return "TOK_SUB_OP";
+        case TokenType::TOK_DIV_OP: return "TOK_DIV_OP";
+        case TokenType::TOK_MULT_OP: return "TOK_MULT_OP";
+        case TokenType::TOK_MOD_OP: return "TOK_MOD_OP";
+        case TokenType::TOK_OR: return "TOK_OR";
+        case TokenType::TOK_AND: return "TOK_AND";
+        case TokenType::TOK_EQ: return "TOK_EQ";
+        case TokenType::TOK_NEQ: return "TOK_NEQ";
+        case TokenType::TOK_LT: return "TOK_LT";
+        case TokenType::TOK_LT_EQ: return "TOK_LT_EQ";
+        case TokenType::TOK_GT: return "TOK_GT";
+        case TokenType::TOK_GT_EQ: return "TOK_GT_EQ";
+        case TokenType::TOK_QUESTION: return "TOK_QUESTION";
+        case TokenType::TOK_COLON: return "TOK_COLON";
+        case TokenType::TOK_OPEN_PAREN: return "TOK_OPEN_PAREN";
+        case TokenType::TOK_CLOSE_PAREN: return "TOK_CLOSE_PAREN";
+        case TokenType::TOK_EOF: return "TOK_EOF";
+        default: return "TOK_UNKNOWN";
+    }
 }
 
-const std::vector<Token> &Lexer::tokenize(const std::string &src) {
-    m_src = src; // Assign source string for tokenization
+const std::vector<Token> &Lexer::tokenize(const std::string_view src) {
+    TRACE_SCOPE("Lexer::tokenize");
+    m_src = src; // View the source string for tokenization
     m_cursor = 0; // Reset cursor position
-    m_tokens.clear(); // Reset token list
+    m_tokens.clear(); // Reset token list, keeping its capacity
 
     while (!eof()) {
         if (std::isdigit(peek()))
@@ -33,23 +57,21 @@ const std::vector<Token> &Lexer::tokenize(const std::string &src) {
             // Skip any whitespaces (tab, space, new line, carriage, etc
             skipWhitespaces();
 
-        else if (peek() == '(')
-            m_tokens.emplace_back(
-                TokenType::TOK_OPEN_PAREN,
-                "TOK_OPEN_PAREN",
-                std::string{advance()});
-        else if (peek() == ')')
-            m_tokens.emplace_back(
-                TokenType::TOK_CLOSE_PAREN,
-                "TOK_CLOSE_PAREN",
-                std::string{advance()});
+        else if (peek() == '(') {
+            advance();
+            emit(TokenType::TOK_OPEN_PAREN, m_cursor - 1);
+        }
+        else if (peek() == ')') {
+            advance();
+            emit(TokenType::TOK_CLOSE_PAREN, m_cursor - 1);
+        }
 
             // Let's assume at this point, what remains is
             // operators.
         else tokenizeOperators();
     }
 
-    m_tokens.emplace_back(TokenType::TOK_EOF, "TOK_EOF", "");
+    emit(TokenType::TOK_EOF, m_cursor);
     return m_tokens;
 }
 
@@ -57,114 +79,143 @@ const std::vector<Token> &Lexer::tokens() {
     return m_tokens;
 }
 
+std::string_view Lexer::text(const Token &token) const {
+    return m_src.substr(token.offset, token.length);
+}
+
+picojson::value Lexer::dump() const {
+    picojson::array arr;
+    for (const auto &token: m_tokens) {
+        picojson::object obj;
+        obj["name"] = picojson::value(tokenName(token.type));
+        obj["value"] = picojson::value(std::string{text(token)});
+        arr.emplace_back(obj);
+    }
+
+    return picojson::value(arr);
+}
+
 void Lexer::tokenizeNumbers() {
-    std::string num;
+    const auto start = m_cursor;
 
     while (!eof() && std::isdigit(peek())) {
-        num += advance();
+        advance();
     }
 
-    m_tokens.emplace_back(TokenType::TOK_NUMBERS_LIT, "TOK_NUMBERS_LIT", num);
+    emit(TokenType::TOK_NUMBERS_LIT, start);
 }
 
 void Lexer::tokenizeString() {
-    std::string str;
-
     advance();
+    const auto start = m_cursor;
+
     while (!eof() && peek() != '"') {
-        str += advance();
+        advance();
     }
 
+    // The token covers the contents only, without the quotes
+    const auto end = m_cursor;
     expect('"', "Expected '\"' to close the string");
-    m_tokens.emplace_back(TokenType::TOK_STRING_LIT, "TOK_STRING_LIT", str);
+    m_tokens.push_back(Token{
+        TokenType::TOK_STRING_LIT,
+        static_cast<std::uint32_t>(start),
+        static_cast<std::uint32_t>(end - start)
+    });
 }
 
 void Lexer::tokenizeIdentifiers() {
-    std::string ident;
+    const auto start = m_cursor;
 
     while (!eof() && (peek() == '_' || std::isalnum(peek()))) {
-        ident += advance();
+        advance();
     }
 
+    const auto ident = m_src.substr(start, m_cursor - start);
     if (ident == "true" || ident == "false") {
-        m_tokens.emplace_back(TokenType::TOK_BOOL_LIT, "TOK_BOOL_LIT", ident);
+        emit(TokenType::TOK_BOOL_LIT, start);
     } else if (ident == "nil") {
-        m_tokens.emplace_back(TokenType::TOK_NULL_LIT, "TOK_NULL_LIT", ident);
+        emit(TokenType::TOK_NULL_LIT, start);
     } else
-        m_tokens.emplace_back(TokenType::TOK_IDENT_LIT, "TOK_IDENT_LIT", ident);
+        emit(TokenType::TOK_IDENT_LIT, start);
 }
 
 void Lexer::tokenizeOperators() {
+    const auto start = m_cursor;
     auto op = advance();
 
     if (op == '+')
-        m_tokens.emplace_back(TokenType::TOK_ADD_OP, "TOK_ADD_LIT", std::string{op});
+        emit(TokenType::TOK_ADD_OP, start);
     else if (op == '-')
-        m_tokens.emplace_back(TokenType::TOK_SUB_OP, "TOK_SUB_LIT", std::string{op});
+        emit(TokenType::TOK_SUB_OP, start);
     else if (op == '*')
-        m_tokens.emplace_back(TokenType::TOK_MULT_OP, "TOK_MULT_LIT", std::string{op});
+        emit(TokenType::TOK_MULT_OP, start);
     else if (op == '/')
-        m_tokens.emplace_back(TokenType::TOK_DIV_OP, "TOK_DIV_LIT", std::string{op});
+        emit(TokenType::TOK_DIV_OP, start);
     else if (op == '%')
-        m_tokens.emplace_back(TokenType::TOK_MOD_OP, "TOK_MOD_OP", std::string{op});
+        emit(TokenType::TOK_MOD_OP, start);
 
     else if (op == '|') {
         if(peek() == '|') { // ||
-            m_tokens.emplace_back(TokenType::TOK_OR, "TOK_OR", std::string{"||"});
             advance();
+            emit(TokenType::TOK_OR, start);
         }
     }
 
     else if (op == '&') {
         if(peek() == '&') { // &&
-            m_tokens.emplace_back(TokenType::TOK_AND, "TOK_AND", std::string{"&&"});
             advance();
+            emit(TokenType::TOK_AND, start);
         }
     }
 
     else if (op == '=') {
         if(peek() == '=') { // ==
-            m_tokens.emplace_back(TokenType::TOK_EQ, "TOK_EQ", std::string{"=="});
             advance();
+            emit(TokenType::TOK_EQ, start);
         }
     }
 
     else if (op == '!') {
         if(peek() == '=') { // !=
-            m_tokens.emplace_back(TokenType::TOK_NEQ, "TOK_NEQ", std::string{"!="});
             advance();
+            emit(TokenType::TOK_NEQ, start);
         }
     }
 
+    else if (op == '?')
+        emit(TokenType::TOK_QUESTION, start);
+    else if (op == ':')
+        emit(TokenType::TOK_COLON, start);
+
     else if (op == '<') {
         if(peek() == '=') { // <=
-            m_tokens.emplace_back(TokenType::TOK_LT_EQ, "TOK_LT_EQ", std::string{"<="});
             advance();
+            emit(TokenType::TOK_LT_EQ, start);
         } else { // <
-            m_tokens.emplace_back(TokenType::TOK_LT, "TOK_LT", std::string{"<"});
+            emit(TokenType::TOK_LT, start);
         }
     }
 
     else if (op == '>') {
         if(peek() == '=') { // >=
-            m_tokens.emplace_back(TokenType::TOK_GT_EQ, "TOK_GT_EQ", std::string{">="});
             advance();
+            emit(TokenType::TOK_GT_EQ, start);
         } else { // >
-            m_tokens.emplace_back(TokenType::TOK_GT, "TOK_GT", std::string{">"});
+            emit(TokenType::TOK_GT, start);
         }
     }
 
-    else throw std::runtime_error(std::format("Unknown Character `{}` in the input string", peek()));
+    else throw std::runtime_error(std::format("Unknown Character `{}` in the input string", op));
 }
 
 void Lexer::skipWhitespaces() {
-    if (std::isspace(peek())) {
+    while (!eof() && std::isspace(peek())) {
         advance();
     }
 }
 
 char Lexer::peek() const {
-    return m_src[m_cursor];
+    return eof() ? '\0' : m_src[m_cursor];
 }
 
 char Lexer::advance() {
@@ -183,3 +234,11 @@ void Lexer::expect(const char c, const std::string &error) {
 
     throw std::runtime_error(error);
 }
+
+void Lexer::emit(const TokenType type, const std::size_t start) {
+    m_tokens.push_back(Token{
+        type,
+        static_cast<std::uint32_t>(start),
+        static_cast<std::uint32_t>(m_cursor - start)
+    });
+}
@@ -0,0 +1,198 @@
+#include "../../include/expr-eval/frontend/optimizer.h"
+#include "../../include/expr-eval/backend/trace.h"
+
+#include <exception>
+#include <optional>
+
+using Type = RuntimeVar::RuntimeVarType;
+
+static std::size_t countNodes(const Node &node) {
+    if (node.type == NodeType::BINARY_EXPR) {
+        const auto &bin = static_cast<const BinaryExpr &>(node);
+        return 1 + countNodes(bin.getLeft()) + countNodes(bin.getRight());
+    }
+
+    if (node.type == NodeType::CONDITIONAL_EXPR) {
+        const auto &cond = static_cast<const ConditionalExpr &>(node);
+        return 1 + countNodes(cond.getCondition()) + countNodes(cond.getThen()) + countNodes(cond.getElse());
+    }
+
+    return 1;
+}
+
+static bool isLiteral(const Node &node) {
+    return node.type == NodeType::NUMBER_LIT
+           || node.type == NodeType::STRING_LIT
+           || node.type == NodeType::BOOLEAN_LIT
+           || node.type == NodeType::NIL_LIT;
+}
+
+static Node *makeLiteral(const RuntimeVar &value, Arena &arena) {
+    switch (value.type) {
+        case Type::NUMBER: return arena.make<NumberLiteral>(value.d_value);
+        case Type::STRING: return arena.make<StringLiteral>(value.str());
+        case Type::BOOL: return arena.make<BooleanLiteral>(value.b_value);
+        default: return arena.make<NullLiteral>();
+    }
+}
+
+// Result type of `node` when it is known without evaluating it
+static std::optional<Type> staticType(const Node &node) {
+    switch (node.type) {
+        case NodeType::NUMBER_LIT: return Type::NUMBER;
+        case NodeType::STRING_LIT: return Type::STRING;
+        case NodeType::BOOLEAN_LIT: return Type::BOOL;
+        case NodeType::NIL_LIT: return Type::NIL;
+        case NodeType::BINARY_EXPR: break;
+        case NodeType::CONDITIONAL_EXPR: {
+            const auto &cond = static_cast<const ConditionalExpr &>(node);
+            const auto t = staticType(cond.getThen());
+            return t == staticType(cond.getElse()) ? t : std::nullopt;
+        }
+        default: return std::nullopt;
+    }
+
+    const auto &bin = static_cast<const BinaryExpr &>(node);
+    switch (bin.getOp()) {
+        case BinaryOp::ADD:
+        case BinaryOp::SUB:
+        case BinaryOp::MUL:
+        case BinaryOp::DIV:
+        case BinaryOp::MOD: {
+            const auto l = staticType(bin.getLeft());
+            const auto r = staticType(bin.getRight());
+            if (l && l == r && (*l == Type::NUMBER || (*l == Type::STRING && bin.getOp() == BinaryOp::ADD)))
+                return l;
+            return std::nullopt;
+        }
+        default: // logical, equality and relational ops always produce a bool
+            return Type::BOOL;
+    }
+}
+
+static bool mayBeNumber(const Node &node) {
+    const auto t = staticType(node);
+    return !t || *t == Type::NUMBER;
+}
+
+static bool isBool(const Node &node) {
+    return staticType(node) == Type::BOOL;
+}
+
+static bool isNumber(const Node &node, const double value) {
+    return node.type == NodeType::NUMBER_LIT && static_cast<const NumberLiteral &>(node).getValue() == value;
+}
+
+static bool isBoolean(const Node &node, const bool value) {
+    return node.type == NodeType::BOOLEAN_LIT && static_cast<const BooleanLiteral &>(node).getValue() == value;
+}
+
+std::size_t OptimizerStats::nodesRemoved() const {
+    return nodesBefore - nodesAfter;
+}
+
+Optimizer::Optimizer(const OptimizerOptions options)
+    : m_options(options) {
+}
+
+OptimizerStats Optimizer::run(Program &program) const {
+    TRACE_SCOPE("Optimizer::run");
+    OptimizerStats stats;
+
+    for (auto &node: program.m_ast) {
+        stats.nodesBefore += countNodes(*node);
+        node = optimize(node, program.m_arena);
+        stats.nodesAfter += countNodes(*node);
+    }
+
+    return stats;
+}
+
+Node *Optimizer::optimize(Node *node, Arena &arena) const {
+    if (node->type == NodeType::CONDITIONAL_EXPR) {
+        auto &cond = static_cast<ConditionalExpr &>(*node);
+        cond.cond = optimize(cond.cond, arena);
+        cond.then = optimize(cond.then, arena);
+        cond.otherwise = optimize(cond.otherwise, arena);
+
+        // A literal condition picks its branch; the other one is dead
+        if (m_options.foldConstants && isLiteral(*cond.cond))
+            return cond.cond->eval({}).toBool() ? cond.then : cond.otherwise;
+
+        return node;
+    }
+
+    if (node->type != NodeType::BINARY_EXPR)
+        return node;
+
+    auto &bin = static_cast<BinaryExpr &>(*node);
+    bin.left = optimize(bin.left, arena);
+    bin.right = optimize(bin.right, arena);
+
+    if (m_options.foldConstants) {
+        if (auto *folded = fold(bin, arena)) return folded;
+    }
+
+    if (m_options.simplify) {
+        if (auto *simplified = simplify(bin, arena)) return simplified;
+    }
+
+    return node;
+}
+
+Node *Optimizer::fold(BinaryExpr &bin, Arena &arena) const {
+    // `false && e` and `true || e` never evaluate `e`
+    if ((bin.op == BinaryOp::AND || bin.op == BinaryOp::OR) && isLiteral(*bin.left)) {
+        const bool l = bin.left->eval({}).toBool();
+        if (l == (bin.op == BinaryOp::OR))
+            return makeLiteral(RuntimeVar{l}, arena);
+    }
+
+    if (!isLiteral(*bin.left) || !isLiteral(*bin.right))
+        return nullptr;
+
+    try {
+        const auto l = bin.left->eval({});
+        const auto r = bin.right->eval({});
+        return makeLiteral((*bin.kernels)(l, r), arena);
+    } catch (const std::exception &) {
+        // Keep the operator so the error is still raised at runtime
+        return nullptr;
+    }
+}
+
+Node *Optimizer::simplify(BinaryExpr &bin, Arena &arena) const {
+    auto *l = bin.left;
+    auto *r = bin.right;
+
+    switch (bin.op) {
+        case BinaryOp::ADD:
+            if (isNumber(*r, 0.0) && mayBeNumber(*l)) return l;
+            if (isNumber(*l, 0.0) && mayBeNumber(*r)) return r;
+            break;
+        case BinaryOp::SUB:
+            if (isNumber(*r, 0.0) && mayBeNumber(*l)) return l;
+            break;
+        case BinaryOp::MUL:
+            if (isNumber(*r, 1.0) && mayBeNumber(*l)) return l;
+            if (isNumber(*l, 1.0) && mayBeNumber(*r)) return r;
+            break;
+        case BinaryOp::DIV:
+            if (isNumber(*r, 1.0) && mayBeNumber(*l)) return l;
+            break;
+        case BinaryOp::AND:
+            if (isBoolean(*l, false) || isBoolean(*r, false)) return makeLiteral(RuntimeVar{false}, arena);
+            if (isBoolean(*l, true) && isBool(*r)) return r;
+            if (isBoolean(*r, true) && isBool(*l)) return l;
+            break;
+        case BinaryOp::OR:
+            if (isBoolean(*l, true) || isBoolean(*r, true)) return makeLiteral(RuntimeVar{true}, arena);
+            if (isBoolean(*l, false) && isBool(*r)) return r;
+            if (isBoolean(*r, false) && isBool(*l)) return l;
+            break;
+        default:
+            break;
+    }
+
+    return nullptr;
+}
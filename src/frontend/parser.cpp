@@ -1,19 +1,55 @@
 #include "../../include/expr-eval/frontend/parser.h"
 #include "../../include/expr-eval/frontend/lexer.h"
 #include "../../include/expr-eval/frontend/ast.h"
+#include "../../include/expr-eval/backend/trace.h"
 
+#include <charconv>
 #include <exception>
 #include <memory>
 #include <stdexcept>
 #include <format>
 
-void Parser::parse(const std::string &src) {
+// Lower an operator token to the BinaryOp evaluated by BinaryExpr
+static BinaryOp binaryOp(const TokenType t) {
+    switch (t) {
+        case TokenType::TOK_ADD_OP: return BinaryOp::ADD;
+        case TokenType::TOK_SUB_OP: return BinaryOp::SUB;
+        case TokenType::TOK_MULT_OP: return BinaryOp::MUL;
+        case TokenType::TOK_DIV_OP: return BinaryOp::DIV;
+        case TokenType::TOK_MOD_OP: return BinaryOp::MOD;
+        case TokenType::TOK_OR: return BinaryOp::OR;
+        case TokenType::TOK_AND: return BinaryOp::AND;
+        case TokenType::TOK_EQ: return BinaryOp::EQ;
+        case TokenType::TOK_NEQ: return BinaryOp::NEQ;
+        case TokenType::TOK_LT: return BinaryOp::LT;
+        case TokenType::TOK_LT_EQ: return BinaryOp::LT_EQ;
+        case TokenType::TOK_GT: return BinaryOp::GT;
+        case TokenType::TOK_GT_EQ: return BinaryOp::GT_EQ;
+        default:
+            throw std::runtime_error("Expected a binary operator");
+    }
+}
+
+void Parser::parse(const std::string_view src, const SymbolTable &symbols) {
+    parseInto(src, symbols, m_program);
+}
+
+std::unique_ptr<Program> Parser::compile(const std::string_view src, const SymbolTable &symbols) {
+    auto program = std::make_unique<Program>();
+    parseInto(src, symbols, *program);
+    return program;
+}
+
+void Parser::parseInto(const std::string_view src, const SymbolTable &symbols, Program &program) {
+    TRACE_SCOPE("Parser::parse");
+    m_symbols = &symbols;
     lexer.tokenize(src);
     m_cursor = 0;
-    m_program.clear();
+    program.clear();
+    m_arena = &program.arena();
 
     while (peek().type != TokenType::TOK_EOF) {
-        m_program.addNode(parseExpr());
+        program.addNode(parseExpr());
     }
 }
 
@@ -25,94 +61,108 @@ Program &Parser::root() {
     return m_program;
 }
 
-std::unique_ptr<Node> Parser::parseExpr() {
-    return parseOr();
+Node *Parser::parseExpr() {
+    return parseConditional();
+}
+
+// cond ? a : b, right-associative so `a ? b : c ? d : e` nests in the else branch
+Node *Parser::parseConditional() {
+    auto cond = parseOr();
+    if (eof() || peek().type != TokenType::TOK_QUESTION)
+        return cond;
+
+    advance();
+    auto then = parseConditional();
+    expect(TokenType::TOK_COLON, "Expected ':' in conditional expression");
+    auto otherwise = parseConditional();
+
+    return m_arena->make<ConditionalExpr>(cond, then, otherwise);
 }
 
 // a || b
-std::unique_ptr<Node> Parser::parseOr() {
+Node *Parser::parseOr() {
     auto left = parseAnd();
     while (!eof() && (
                peek().type == TokenType::TOK_OR
            )) {
-        std::string op = advance().value;
+        const auto op = binaryOp(advance().type);
         auto right = parseAnd();
 
-        left = std::make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+        left = m_arena->make<BinaryExpr>(left, op, right);
     }
 
     return left;
 }
 
-std::unique_ptr<Node> Parser::parseAnd() {
+Node *Parser::parseAnd() {
     auto left = parseEquality();
     while (!eof() && ( peek().type == TokenType::TOK_AND )) {
-        std::string op = advance().value;
+        const auto op = binaryOp(advance().type);
         auto right = parseEquality();
 
-        left = std::make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+        left = m_arena->make<BinaryExpr>(left, op, right);
     }
 
     return left;
 }
 
-std::unique_ptr<Node> Parser::parseEquality() {
+Node *Parser::parseEquality() {
     auto left = parseRelational();
     while (!eof() && ( peek().type == TokenType::TOK_EQ || peek().type == TokenType::TOK_NEQ )) {
-        std::string op = advance().value;
+        const auto op = binaryOp(advance().type);
         auto right = parseRelational();
 
-        left = std::make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+        left = m_arena->make<BinaryExpr>(left, op, right);
     }
 
     return left;
 }
 
-std::unique_ptr<Node> Parser::parseRelational() {
+Node *Parser::parseRelational() {
     auto left = parseAdditives();
     while (!eof() && ( peek().type == TokenType::TOK_LT
         || peek().type == TokenType::TOK_LT_EQ
         || peek().type == TokenType::TOK_GT
         || peek().type == TokenType::TOK_GT_EQ )) {
-        std::string op = advance().value;
+        const auto op = binaryOp(advance().type);
         auto right = parseAdditives();
 
-        left = std::make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+        left = m_arena->make<BinaryExpr>(left, op, right);
     }
 
     return left;
 }
 
-std::unique_ptr<Node> Parser::parseAdditives() {
+Node *Parser::parseAdditives() {
     auto left = parseFactors();
     while (!eof() && (
                peek().type == TokenType::TOK_ADD_OP ||
                peek().type == TokenType::TOK_SUB_OP
            )) {
-        std::string op = advance().value;
+        const auto op = binaryOp(advance().type);
         auto right = parseFactors();
 
-        left = std::make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+        left = m_arena->make<BinaryExpr>(left, op, right);
     }
 
     return left;
 }
 
-std::unique_ptr<Node> Parser::parseFactors() {
+Node *Parser::parseFactors() {
     auto left = parsePrimary();
     while (!eof()) {
         if ( peek().type == TokenType::TOK_MULT_OP ||
             peek().type == TokenType::TOK_DIV_OP ||
             peek().type == TokenType::TOK_MOD_OP) {
-            std::string op = advance().value;
+            const auto op = binaryOp(advance().type);
             auto right = parsePrimary();
 
-            left = std::make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+            left = m_arena->make<BinaryExpr>(left, op, right);
         }
 
         else if(peek().type == TokenType::TOK_OPEN_PAREN) {
             auto right = parsePrimary();
-            left = std::make_unique<BinaryExpr>(std::move(left), "*", std::move(right));
+            left = m_arena->make<BinaryExpr>(left, BinaryOp::MUL, right);
         }
 
         else
@@ -122,27 +172,31 @@ std::unique_ptr<Node> Parser::parseFactors() {
     return left;
 }
 
-std::unique_ptr<Node> Parser::parsePrimary() {
+Node *Parser::parsePrimary() {
     switch (peek().type) {
         case TokenType::TOK_NUMBERS_LIT: {
-            auto token = advance();
-            return std::make_unique<NumberLiteral>(token.value);
+            const auto text = lexer.text(advance());
+            double d = 0.0;
+            std::from_chars(text.data(), text.data() + text.size(), d);
+            return m_arena->make<NumberLiteral>(d);
         }
         case TokenType::TOK_STRING_LIT: {
-            auto token = advance();
-            return std::make_unique<StringLiteral>(token.value);
+            return m_arena->make<StringLiteral>(lexer.text(advance()));
         }
         case TokenType::TOK_BOOL_LIT: {
-            auto token = advance();
-            return std::make_unique<BooleanLiteral>(token.value);
+            return m_arena->make<BooleanLiteral>(lexer.text(advance()) == "true");
         }
         case TokenType::TOK_NULL_LIT: {
-            auto token = advance();
-            return std::make_unique<NullLiteral>();
+            advance();
+            return m_arena->make<NullLiteral>();
         }
         case TokenType::TOK_IDENT_LIT: {
-            auto token = advance();
-            return std::make_unique<IdentifierLiteral>(token.value);
+            const auto ident = lexer.text(advance());
+            const auto slot = m_symbols->lookup(ident);
+            if (!slot)
+                throw std::runtime_error(std::format("Use of undefined variable `{}`", ident));
+
+            return m_arena->make<IdentifierLiteral>(m_arena->copy(ident), *slot);
         }
         case TokenType::TOK_OPEN_PAREN: {
             advance();
@@ -152,16 +206,16 @@ std::unique_ptr<Node> Parser::parsePrimary() {
             return left;
         }
         default: {
-            throw std::runtime_error(std::format("Unknown Token `{}`", peek().value));
+            throw std::runtime_error(std::format("Unknown Token `{}`", lexer.text(peek())));
         }
     }
 }
 
-Token Parser::peek() {
+const Token &Parser::peek() {
     return lexer.tokens().at(m_cursor);
 }
 
-Token Parser::advance() {
+const Token &Parser::advance() {
     return lexer.tokens().at(m_cursor++);
 }
 
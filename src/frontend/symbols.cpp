@@ -0,0 +1,25 @@
+#include "../../include/expr-eval/frontend/symbols.h"
+
+std::size_t SymbolTable::declare(const std::string &ident) {
+    const auto [it, inserted] = m_slots.try_emplace(ident, m_names.size());
+    if (inserted)
+        m_names.push_back(ident);
+
+    return it->second;
+}
+
+std::optional<std::size_t> SymbolTable::lookup(const std::string_view ident) const {
+    const auto it = m_slots.find(ident);
+    if (it == m_slots.end())
+        return std::nullopt;
+
+    return it->second;
+}
+
+const std::string &SymbolTable::name(const std::size_t slot) const {
+    return m_names.at(slot);
+}
+
+std::size_t SymbolTable::size() const {
+    return m_names.size();
+}
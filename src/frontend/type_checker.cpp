@@ -0,0 +1,193 @@
+#include "../../include/expr-eval/frontend/type_checker.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <format>
+
+using Type = RuntimeVar::RuntimeVarType;
+
+std::string_view staticTypeStr(const StaticType type) {
+    switch (type) {
+        case StaticType::STRING: return "string";
+        case StaticType::NUMBER: return "number";
+        case StaticType::NIL: return "nil";
+        case StaticType::BOOL: return "bool";
+        default: return "any";
+    }
+}
+
+// ----- SCHEMA ----- //
+void Schema::declare(const std::size_t slot, const Type type) {
+    m_types[slot] = type;
+}
+
+std::optional<Type> Schema::typeOf(const std::size_t slot) const {
+    const auto it = m_types.find(slot);
+    if (it == m_types.end())
+        return std::nullopt;
+
+    return it->second;
+}
+
+Schema Schema::parse(const std::string_view text, const SymbolTable &symbols) {
+    auto trim = [](std::string_view s) {
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front())))
+            s.remove_prefix(1);
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back())))
+            s.remove_suffix(1);
+        return s;
+    };
+
+    Schema schema;
+    std::size_t pos = 0;
+    while (pos <= text.size()) {
+        auto end = text.find(',', pos);
+        if (end == std::string_view::npos)
+            end = text.size();
+
+        const auto decl = trim(text.substr(pos, end - pos));
+        pos = end + 1;
+        if (decl.empty() && end == text.size())
+            break;
+
+        const auto colon = decl.find(':');
+        if (colon == std::string_view::npos)
+            throw std::runtime_error(std::format("Expected `name: type` in schema but found `{}`", decl));
+
+        const auto name = trim(decl.substr(0, colon));
+        const auto typeName = trim(decl.substr(colon + 1));
+
+        const auto slot = symbols.lookup(name);
+        if (!slot)
+            throw std::runtime_error(std::format("Use of undefined variable `{}` in schema", name));
+
+        if (typeName == "string") schema.declare(*slot, Type::STRING);
+        else if (typeName == "number") schema.declare(*slot, Type::NUMBER);
+        else if (typeName == "bool") schema.declare(*slot, Type::BOOL);
+        else if (typeName == "nil") schema.declare(*slot, Type::NIL);
+        else throw std::runtime_error(std::format("Unknown type `{}` for `{}` in schema", typeName, name));
+    }
+
+    return schema;
+}
+
+// ----- TYPE CHECKER ----- //
+TypeChecker::TypeChecker(const Schema &schema) : m_schema(schema) {
+}
+
+StaticType TypeChecker::check(const Program &program) {
+    m_types.clear();
+    m_inputs.clear();
+
+    auto res = StaticType::NIL;
+    for (const auto *node: program.getNodes())
+        res = infer(*node);
+
+    m_types[&program] = res;
+    return res;
+}
+
+StaticType TypeChecker::typeOf(const Node &node) const {
+    const auto it = m_types.find(&node);
+    return it == m_types.end() ? StaticType::ANY : it->second;
+}
+
+const std::vector<TypeChecker::Input> &TypeChecker::inputs() const {
+    return m_inputs;
+}
+
+StaticType TypeChecker::infer(const Node &node) {
+    StaticType type;
+
+    switch (node.type) {
+        case NodeType::NUMBER_LIT:
+            type = StaticType::NUMBER;
+            break;
+        case NodeType::STRING_LIT:
+            type = StaticType::STRING;
+            break;
+        case NodeType::BOOLEAN_LIT:
+            type = StaticType::BOOL;
+            break;
+        case NodeType::NIL_LIT:
+            type = StaticType::NIL;
+            break;
+        case NodeType::IDENT_LIT: {
+            const auto &ident = static_cast<const IdentifierLiteral &>(node);
+            const auto declared = m_schema.typeOf(ident.getSlot());
+            if (!declared)
+                throw std::runtime_error(std::format("Type error: variable `{}` has no declared type",
+                                                     ident.getValue()));
+
+            if (std::none_of(m_inputs.begin(), m_inputs.end(),
+                             [&](const Input &in) { return in.slot == ident.getSlot(); }))
+                m_inputs.push_back(Input{ident.getSlot(), *declared, ident.getValue()});
+
+            type = static_cast<StaticType>(*declared);
+            break;
+        }
+        case NodeType::BINARY_EXPR:
+            type = inferBinary(static_cast<const BinaryExpr &>(node));
+            break;
+        case NodeType::CONDITIONAL_EXPR: {
+            const auto &cond = static_cast<const ConditionalExpr &>(node);
+            infer(cond.getCondition()); // any value has a truthiness
+            const auto then = infer(cond.getThen());
+            const auto otherwise = infer(cond.getElse());
+            type = then == otherwise ? then : StaticType::ANY;
+            break;
+        }
+        default:
+            throw std::runtime_error(std::format("Cannot type check node `{}`", node.name));
+    }
+
+    m_types[&node] = type;
+    return type;
+}
+
+// Mirrors the RuntimeVar operators and their error messages
+StaticType TypeChecker::inferBinary(const BinaryExpr &bin) {
+    const auto op = bin.getOp();
+    const auto l = infer(bin.getLeft());
+    const auto r = infer(bin.getRight());
+
+    if (op == BinaryOp::AND || op == BinaryOp::OR)
+        return StaticType::BOOL;
+
+    auto unsupported = [&](const StaticType type) {
+        return std::runtime_error(std::format("Type error: op '{}' not supported for type {}",
+                                              binaryOpStr(op), staticTypeStr(type)));
+    };
+
+    // With a side only known at runtime, the checked operator compares
+    // the types there; the other side can still rule the operator out
+    const bool dynamic = l == StaticType::ANY || r == StaticType::ANY;
+    if (!dynamic && l != r)
+        throw std::runtime_error(std::format("Type error: expected same types to op '{}' but found {} and {}.",
+                                             binaryOpStr(op), staticTypeStr(l), staticTypeStr(r)));
+
+    const auto type = l == StaticType::ANY ? r : l;
+    const bool any = type == StaticType::ANY;
+
+    switch (op) {
+        case BinaryOp::ADD:
+            if (!any && type != StaticType::NUMBER && type != StaticType::STRING)
+                throw unsupported(type);
+            return type;
+        case BinaryOp::SUB:
+        case BinaryOp::MUL:
+        case BinaryOp::DIV:
+        case BinaryOp::MOD:
+            if (!any && type != StaticType::NUMBER)
+                throw unsupported(type);
+            return StaticType::NUMBER;
+        case BinaryOp::EQ:
+        case BinaryOp::NEQ:
+            return StaticType::BOOL;
+        default: // ordering
+            if (!any && type != StaticType::NUMBER && type != StaticType::STRING)
+                throw unsupported(type);
+            return StaticType::BOOL;
+    }
+}
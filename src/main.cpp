@@ -1,26 +1,77 @@
+#include <cstdio>
+#include <cstring>
 #include <exception>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
 #include "../include/expr-eval/backend/runtime.h"
 #include "../include/expr-eval/backend/interpreter.h"
+#include "../include/expr-eval/backend/mapped_file.h"
+#include "../include/expr-eval/backend/stream_runner.h"
+#include "../include/expr-eval/backend/thread_pool.h"
+#include "../include/expr-eval/backend/trace.h"
 
-// REPL
-int main() {
-    // Create an Interpreter instance
-    Interpreter ip;
+// Peak resident set size of the process, for comparing input paths
+static void printPeakRss() {
+#if !defined(_WIN32)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        std::fprintf(stderr, "peak RSS: %.1f MiB\n", static_cast<double>(usage.ru_maxrss) / 1024.0);
+#endif
+}
 
-    // Add global variables
-    ip.addVar("f_name", RuntimeVar(std::string{"John"}));
-    ip.addVar("l_name", RuntimeVar(std::string{"Doe"}));
-    ip.addVar("x", RuntimeVar(23.45));
-    ip.addVar("PI", RuntimeVar(3.14));
+// Evaluate one expression per line of `path` (`-` for stdin), NDJSON to
+// stdout and throughput stats to stderr. Regular files are mmap'd and
+// processed on a thread pool unless `mapped` is false; pipes and other
+// special files are streamed like stdin.
+static int runBatch(const Interpreter &ip, const char *path, const bool mapped) {
+    const StreamOptions options{ip.engine()};
+    const bool isStdin = std::strcmp(path, "-") == 0;
+
+    try {
+        StreamRunner runner{ip.symbols(), ip.makeContext(), options};
+        StreamStats stats;
+
+        if (mapped && !isStdin && MappedFile::mappable(path)) {
+            const MappedFile file{path};
+            ThreadPool pool;
+            stats = runner.run(file, stdout, pool);
+        } else if (isStdin) {
+            std::ios::sync_with_stdio(false);
+            stats = runner.run(std::cin, stdout);
+        } else {
+            // Large read buffer; must be installed before the file is opened
+            static char buffer[1 << 20];
+            std::ifstream file;
+            file.rdbuf()->pubsetbuf(buffer, sizeof buffer);
+            file.open(path, std::ios::binary);
+            if (!file)
+                throw std::runtime_error(std::string{"Cannot open `"} + path + "`");
+            stats = runner.run(file, stdout);
+        }
+
+        stats.print(stderr);
+        printPeakRss();
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
 
+// Read-eval-print loop on stdin until `exit` or end of input
+static void runRepl(Interpreter &ip) {
     while(true) {
         std::cout << ">>> " << std::flush;
 
         std::string input;
-        std::getline(std::cin, input);
+        if (!std::getline(std::cin, input)) break;
 
         // Exit REPL using `exit` command
         if(input == "exit") break;
@@ -32,5 +83,52 @@ int main() {
            std::cout << "error: " << e.what() << std::endl;
        }
     }
-    return 0;
+}
+
+// REPL by default, or `--batch <file|->` for non-interactive use;
+// `--trace <path>` writes a Chrome trace of the session on exit
+int main(int argc, char **argv) {
+    const char *batchPath = nullptr, *tracePath = nullptr;
+    bool mapped = true;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc) {
+            batchPath = argv[++i];
+        } else if (arg == "--no-mmap") {
+            mapped = false;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--batch <file|-> [--no-mmap]] [--trace <path>]" << std::endl;
+            return 2;
+        }
+    }
+
+    // Create an Interpreter instance
+    Interpreter ip;
+
+    // Add global variables
+    ip.addVar("f_name", RuntimeVar(std::string{"John"}));
+    ip.addVar("l_name", RuntimeVar(std::string{"Doe"}));
+    ip.addVar("x", RuntimeVar(23.45));
+    ip.addVar("PI", RuntimeVar(3.14));
+
+    if (tracePath) Tracer::enable();
+
+    int status = 0;
+    if (batchPath)
+        status = runBatch(ip, batchPath, mapped);
+    else
+        runRepl(ip);
+
+    if (tracePath) {
+        Tracer::disable();
+        try {
+            Tracer::write(tracePath);
+        } catch (const std::exception &e) {
+            std::cerr << "error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    return status;
 }
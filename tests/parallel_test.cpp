@@ -0,0 +1,198 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/expr-eval/backend/interpreter.h"
+#include "../include/expr-eval/backend/formula_graph.h"
+#include "../include/expr-eval/backend/thread_pool.h"
+
+// Multi-threaded paths, run with a fixed number of workers so they are
+// exercised even where hardware_concurrency() is 1. Exits non-zero if
+// any check fails.
+
+static constexpr std::size_t kWorkers = 4;
+
+static int failures = 0;
+
+static void check(const bool ok, const std::string &what) {
+    if (!ok) {
+        std::printf("FAIL: %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+// ----- THREAD POOL ----- //
+
+static void testThreadPool() {
+    ThreadPool pool{kWorkers};
+    check(pool.size() == kWorkers, "pool has the requested number of workers");
+
+    // Every index runs exactly once, spread over more than one worker
+    constexpr std::size_t count = 20000;
+    std::vector<std::atomic<int> > runs(count);
+    std::vector<std::atomic<bool> > used(kWorkers);
+    for (int round = 0; round < 20; ++round) {
+        pool.parallelFor(count, [&](const std::size_t i, const std::size_t worker) {
+            runs[i].fetch_add(1, std::memory_order_relaxed);
+            used[worker].store(true, std::memory_order_relaxed);
+
+            // Uneven tasks so that idle workers steal
+            if (i % 64 == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+        });
+    }
+
+    std::size_t wrong = 0;
+    for (const auto &n: runs)
+        wrong += n.load() != 20;
+    check(wrong == 0, std::format("parallelFor ran {} indices the wrong number of times", wrong));
+
+    std::size_t active = 0;
+    for (const auto &u: used)
+        active += u.load();
+    check(active > 1, std::format("parallelFor used {} of {} workers", active, kWorkers));
+
+    // The first exception is rethrown and the pool stays usable
+    bool thrown = false;
+    try {
+        pool.parallelFor(100, [](const std::size_t i, std::size_t) {
+            if (i == 42) throw std::runtime_error("boom");
+        });
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    check(thrown, "parallelFor rethrows a task's exception");
+
+    std::atomic<std::size_t> after{0};
+    pool.parallelFor(100, [&](std::size_t, std::size_t) { after.fetch_add(1); });
+    check(after.load() == 100, "pool runs tasks after an exception");
+
+    // Plain submit from several threads at once, then shut down with
+    // tasks possibly still queued: all of them must run
+    std::atomic<std::size_t> submitted{0};
+    {
+        ThreadPool burst{kWorkers};
+        std::vector<std::thread> producers;
+        for (std::size_t t = 0; t < kWorkers; ++t) {
+            producers.emplace_back([&] {
+                for (int i = 0; i < 5000; ++i)
+                    burst.submit([&](std::size_t) { submitted.fetch_add(1, std::memory_order_relaxed); });
+            });
+        }
+        for (auto &t: producers)
+            t.join();
+    }
+    check(submitted.load() == kWorkers * 5000, std::format("{} of {} submitted tasks ran", submitted.load(), kWorkers * 5000));
+}
+
+// ----- SHARED COMPILED EXPRESSIONS ----- //
+
+static void testSharedExpr() {
+    Interpreter ip;
+    ip.addVar("qty", RuntimeVar(0.0));
+    ip.addVar("price", RuntimeVar(2.5));
+    ip.addVar("name", RuntimeVar(std::string{"item"}));
+    const auto qty = ip.slotOf("qty");
+
+    const auto src = "price * qty > 20 && qty < 14 ? name + \" ok\" : name + \" no\"";
+    for (const auto engine: {Engine::TREE_WALKER, Engine::BYTECODE, Engine::JIT}) {
+        ip.setEngine(engine);
+        const auto expr = ip.compile(src);
+
+        // Every thread evaluates the same expression with its own context
+        // and must see the same results as a single-threaded run
+        auto run = [&](std::string &out) {
+            auto ctx = ip.makeContext();
+            out.clear();
+            for (std::size_t i = 0; i < 2000; ++i) {
+                ctx.set(qty, RuntimeVar(static_cast<double>(i % 16)));
+                out += expr.eval(ctx).toString();
+            }
+        };
+
+        std::string expected;
+        run(expected);
+
+        std::vector<std::string> results(kWorkers);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < kWorkers; ++t)
+            threads.emplace_back(run, std::ref(results[t]));
+        for (auto &t: threads)
+            t.join();
+
+        for (std::size_t t = 0; t < kWorkers; ++t)
+            check(results[t] == expected, std::format("engine {} thread {} differs", static_cast<int>(engine), t));
+    }
+}
+
+// ----- FORMULA GRAPH ----- //
+
+static void testFormulaGraph() {
+    constexpr std::size_t columns = 16, rows = 8;
+
+    // Two interpreters with the same formulas, one recomputed serially
+    // and one level-parallel; their values must agree after every change
+    Interpreter serialIp, parallelIp;
+    FormulaGraph serial{serialIp}, parallel{parallelIp};
+    for (auto *ip: {&serialIp, &parallelIp}) {
+        for (std::size_t c = 0; c < columns; ++c)
+            ip->addVar(std::format("in{}", c), RuntimeVar(static_cast<double>(c)));
+    }
+
+    std::vector<std::string> names;
+    for (std::size_t c = 0; c < columns; ++c) {
+        for (std::size_t r = 0; r < rows; ++r) {
+            const auto name = std::format("c{}r{}", c, r);
+            const auto src = r == 0
+                                 ? std::format("in{} * 2", c)
+                                 : std::format("c{}r{} > 50 ? c{}r{} - in{} : c{}r{} + in{} + {}",
+                                               c, r - 1, c, r - 1, (c + 1) % columns, c, r - 1, c, r);
+            serial.define(name, src);
+            parallel.define(name, src);
+            names.push_back(name);
+        }
+    }
+    // Formulas reading across columns make the levels wider than one
+    serial.define("total", "c0r7 + c5r7 + c15r7");
+    parallel.define("total", "c0r7 + c5r7 + c15r7");
+    names.push_back("total");
+
+    ThreadPool pool{kWorkers};
+    for (std::size_t round = 0; round < 50; ++round) {
+        const auto in = std::format("in{}", (round * 7) % columns);
+        const auto value = RuntimeVar(static_cast<double>(round % 11));
+        serialIp.setVar(serialIp.slotOf(in), value);
+        parallelIp.setVar(parallelIp.slotOf(in), value);
+
+        const auto s = serial.recompute();
+        const auto p = parallel.recompute(pool);
+        check(s.recomputed == p.recomputed && s.errors == p.errors,
+              std::format("round {}: recomputed {}/{} errors {}/{}", round, s.recomputed, p.recomputed, s.errors, p.errors));
+
+        for (const auto &name: names) {
+            const auto want = serialIp.getVar(name).toString();
+            const auto got = parallelIp.getVar(name).toString();
+            check(want == got, std::format("round {}: {} is {} in parallel, {} serially", round, name, got, want));
+        }
+    }
+}
+
+int main() {
+    testThreadPool();
+    testSharedExpr();
+    testFormulaGraph();
+
+    if (failures != 0) {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+
+    std::printf("all parallel checks passed\n");
+    return 0;
+}